@@ -0,0 +1,487 @@
+// Persistence benchmark. Generates a synthetic world, then times the save and load paths and
+// writes the results as JSON, so that changes to the persistence layer can be compared.
+//
+//   coremud_bench --objects 100000 --db bench.sqlite3 --out results.json
+
+#include "core/base.h"
+#include "core/backup.h"
+#include "core/config.h"
+#include "core/database.h"
+#include "core/journal.h"
+#include "core/link.h"
+#include "core/ndjson.h"
+#include "core/prototype.h"
+#include "core/api.h"
+#include "core/zone.h"
+#include <boost/program_options.hpp>
+#include <spdlog/sinks/null_sink.h>
+#include <sys/resource.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace po = boost::program_options;
+using namespace core;
+
+struct WorldOptions {
+    std::size_t objects{10000};
+    std::size_t areas{0};
+    std::size_t roomsPerArea{50};
+    std::size_t expanses{0};
+    std::size_t poisPerExpanse{20};
+    // The chance that an object goes inside another object rather than a room or an expanse.
+    double nestChance{0.3};
+    std::size_t descriptionLength{200};
+    uint32_t seed{1};
+};
+
+// Every timing, as seconds plus whatever rate or size goes with it.
+static nlohmann::json results = nlohmann::json::object();
+
+class Timer {
+public:
+    Timer() : started(std::chrono::steady_clock::now()) {};
+    [[nodiscard]] double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+private:
+    std::chrono::steady_clock::time_point started;
+};
+
+static void report(const std::string& name, double seconds, std::size_t count) {
+    auto &r = results[name];
+    r["seconds"] = seconds;
+    r["count"] = count;
+    r["perSecond"] = seconds > 0 ? count / seconds : 0.0;
+    fmt::print(stderr, "{:<28} {:>10} in {:>9.3f}s  {:>12.0f}/s\n", name, count, seconds, r["perSecond"].get<double>());
+}
+
+static int64_t peakRssKiB() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static uint64_t fileSize(const std::string& path) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+static std::string randomText(std::mt19937& rng, std::size_t length) {
+    static const std::string words[] = {"the", "ancient", "stone", "corridor", "winds", "north", "past", "a",
+                                        "crumbling", "statue", "of", "forgotten", "king", "dust", "lies", "thick"};
+    std::uniform_int_distribution<std::size_t> pick(0, std::size(words) - 1);
+    std::string out;
+    out.reserve(length + 16);
+    while(out.size() < length) {
+        if(!out.empty()) out.push_back(' ');
+        out += words[pick(rng)];
+    }
+    return out;
+}
+
+static void generateWorld(const WorldOptions& opt) {
+    std::mt19937 rng(opt.seed);
+    auto areas = opt.areas ? opt.areas : std::max<std::size_t>(1, opt.objects / 1000);
+    auto expanses = opt.expanses ? opt.expanses : std::max<std::size_t>(1, areas / 4);
+
+    std::vector<entt::entity> zones;
+    for(std::size_t a = 0; a < areas; a++) {
+        auto area = createObject();
+        registry.emplace<Name>(area, fmt::format("Area {}", a));
+        registry.emplace<Area>(area);
+        auto owner = registry.get<ObjectId>(area);
+        for(RoomId r = 0; r < opt.roomsPerArea; r++) {
+            auto room = registry.create();
+            registry.get<Area>(area).data.emplace(r, room);
+            registry.emplace<Room>(room, owner, r);
+            registry.emplace<Name>(room, fmt::format("Room {} of Area {}", r, a));
+            registry.emplace<RoomDescription>(room, randomText(rng, opt.descriptionLength));
+        }
+        zones.push_back(area);
+    }
+
+    std::uniform_int_distribution<GridLength> coord(-1000, 1000);
+    for(std::size_t e = 0; e < expanses; e++) {
+        auto expanse = createObject();
+        registry.emplace<Name>(expanse, fmt::format("Expanse {}", e));
+        registry.emplace<Expanse>(expanse);
+        auto owner = registry.get<ObjectId>(expanse);
+        for(std::size_t p = 0; p < opt.poisPerExpanse; p++) {
+            GridPoint point(coord(rng), coord(rng), 0);
+            if(registry.get<Expanse>(expanse).poi.contains(point)) continue;
+            auto poi = registry.create();
+            registry.get<Expanse>(expanse).poi.emplace(point, poi);
+            registry.emplace<PointOfInterest>(poi, owner, SubEntityKind::ExpansePoi, point);
+            registry.emplace<Name>(poi, fmt::format("Point {} of Expanse {}", p, e));
+        }
+        zones.push_back(expanse);
+    }
+
+    std::vector<entt::entity> placed;
+    placed.reserve(opt.objects);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<std::size_t> pickZone(0, zones.size() - 1);
+    for(std::size_t i = 0; i < opt.objects; i++) {
+        auto ent = createObject();
+        bool character = i % 10 == 0;
+        if(character) registry.emplace<Character>(ent);
+        else registry.emplace<Item>(ent);
+        registry.emplace<Name>(ent, fmt::format("{} {}", character ? "character" : "item", i));
+        registry.emplace<ShortDescription>(ent, randomText(rng, opt.descriptionLength / 4));
+        registry.emplace<LookDescription>(ent, randomText(rng, opt.descriptionLength));
+
+        entt::entity target;
+        if(!placed.empty() && chance(rng) < opt.nestChance) {
+            target = placed[std::uniform_int_distribution<std::size_t>(0, placed.size() - 1)(rng)];
+        } else {
+            target = zones[pickZone(rng)];
+        }
+        setLocation(ent, target);
+        if(registry.all_of<Area>(target)) {
+            registry.emplace<RoomLocation>(ent, std::uniform_int_distribution<RoomId>(0, opt.roomsPerArea ? opt.roomsPerArea - 1 : 0)(rng));
+        } else if(registry.all_of<Expanse>(target)) {
+            registry.emplace<GridLocation>(ent, GridPoint(coord(rng), coord(rng), 0));
+        }
+        placed.push_back(ent);
+    }
+}
+
+// Removes everything from the registry without it counting as changes.
+static void clearWorld() {
+    FlagGuard guard(gameIsLoading, true);
+    registry.clear();
+    objects.clear();
+    coldObjects.clear();
+    coldZoneContents.clear();
+    dirty.clear();
+    dirtyComponents.clear();
+    dirtySubEntities.clear();
+    resetFreeObjectIds();
+}
+
+static std::vector<entt::entity> allObjects() {
+    std::vector<entt::entity> out;
+    for(auto ent : registry.view<ObjectId>()) out.push_back(ent);
+    return out;
+}
+
+static void flushSaves() {
+    if(journal) dbWriter->submit(compactJournal);
+    dbWriter->flush();
+    processSaveResults();
+}
+
+int main(int argc, char** argv) {
+    WorldOptions opt;
+    std::string dbPath = "coremud_bench.sqlite3", outPath = "coremud_bench.json";
+    bool useJournal = false;
+    std::size_t prototypeLookups = 100000, spawnCount = 10000;
+
+    po::options_description desc("coremud persistence benchmark");
+    desc.add_options()
+            ("help", "show this message")
+            ("objects", po::value(&opt.objects)->default_value(opt.objects), "number of items and characters")
+            ("areas", po::value(&opt.areas)->default_value(opt.areas), "number of Areas; 0 for one per 1000 objects")
+            ("rooms", po::value(&opt.roomsPerArea)->default_value(opt.roomsPerArea), "rooms per Area")
+            ("expanses", po::value(&opt.expanses)->default_value(opt.expanses), "number of Expanses; 0 for one per 4 Areas")
+            ("pois", po::value(&opt.poisPerExpanse)->default_value(opt.poisPerExpanse), "points of interest per Expanse")
+            ("nest", po::value(&opt.nestChance)->default_value(opt.nestChance), "chance an object is put inside another")
+            ("description", po::value(&opt.descriptionLength)->default_value(opt.descriptionLength), "description length in bytes")
+            ("seed", po::value(&opt.seed)->default_value(opt.seed), "random seed")
+            ("binary", po::value(&config::dbBinaryObjects)->default_value(config::dbBinaryObjects), "save objects as MessagePack")
+            ("journal", po::bool_switch(&useJournal), "save through the append-only journal")
+            ("threads", po::value(&config::dbLoadThreads)->default_value(config::dbLoadThreads), "parser threads; 0 for one per core")
+            ("lookups", po::value(&prototypeLookups)->default_value(prototypeLookups), "getPrototype() calls to time")
+            ("spawn", po::value(&spawnCount)->default_value(spawnCount), "objects to spawn from a prototype")
+            ("db", po::value(&dbPath)->default_value(dbPath), "database file; replaced if it exists")
+            ("out", po::value(&outPath)->default_value(outPath), "where to write the results");
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch(std::exception& e) {
+        fmt::print(stderr, "{}\n", e.what());
+        return 1;
+    }
+    if(vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+
+    // The game's own log output would drown out the numbers.
+    logger = std::make_shared<spdlog::logger>("bench", std::make_shared<spdlog::sinks::null_sink_mt>());
+    executor = std::make_unique<boost::asio::io_context>();
+    linkManager = std::make_unique<LinkManager>();
+
+    for(auto suffix : {"", "-wal", "-shm"}) std::filesystem::remove(dbPath + suffix);
+    config::dbName = dbPath;
+    config::dbSnapshotName.clear();
+    config::dbJournalName = useJournal ? dbPath + ".journal" : "";
+    if(useJournal) std::filesystem::remove(config::dbJournalName);
+    readyDatabase();
+
+    results["options"] = {
+            {"objects", opt.objects}, {"areas", opt.areas}, {"roomsPerArea", opt.roomsPerArea},
+            {"expanses", opt.expanses}, {"poisPerExpanse", opt.poisPerExpanse}, {"nestChance", opt.nestChance},
+            {"descriptionLength", opt.descriptionLength}, {"seed", opt.seed}, {"binary", config::dbBinaryObjects},
+            {"journal", useJournal}, {"threads", config::dbLoadThreads}
+    };
+
+    gameIsLoading = false;
+    {
+        Timer t;
+        generateWorld(opt);
+        report("generate", t.seconds(), registry.view<ObjectId>().size());
+    }
+    auto ents = allObjects();
+
+    {
+        Timer t;
+        for(auto ent : ents) serializeEntity(ent, false, false);
+        report("serializeEntity", t.seconds(), ents.size());
+    }
+    {
+        Timer t;
+        auto out = serializeEntities(ents, false, false);
+        report("serializeEntities", t.seconds(), out.size());
+    }
+    {
+        // Prototype json has no relationships, so it can be loaded onto bare entities. Zones are
+        // left out, as their rooms and points of interest are keyed by the zone's ObjectId.
+        std::vector<nlohmann::json> data;
+        data.reserve(ents.size());
+        for(auto ent : ents) {
+            if(!isZone(ent)) data.push_back(serializeEntity(ent, true, false));
+        }
+        FlagGuard guard(gameIsLoading, true);
+        std::vector<entt::entity> scratch(data.size());
+        registry.create(scratch.begin(), scratch.end());
+        Timer t;
+        for(std::size_t i = 0; i < data.size(); i++) deserializeEntity(scratch[i], data[i]);
+        report("deserializeEntity", t.seconds(), data.size());
+        registry.destroy(scratch.begin(), scratch.end());
+    }
+
+    {
+        Timer t;
+        saveAllObjects();
+        flushSaves();
+        report("saveAll", t.seconds(), ents.size());
+    }
+    {
+        // A typical tick's worth of edits: one object in a hundred changes its name.
+        std::size_t changed = 0;
+        for(std::size_t i = 0; i < ents.size(); i += 100, changed++) {
+            registry.replace<Name>(ents[i], fmt::format("renamed {}", i));
+        }
+        Timer t;
+        processDirty();
+        flushSaves();
+        report("processDirty", t.seconds(), changed);
+    }
+
+    db->exec("PRAGMA wal_checkpoint(TRUNCATE);");
+    results["disk"] = {{"database", fileSize(dbPath)}, {"wal", fileSize(dbPath + "-wal")},
+                       {"journal", useJournal ? fileSize(config::dbJournalName) : 0}};
+    results["peakRssKiBAfterSave"] = peakRssKiB();
+
+    {
+        auto backupPath = dbPath + ".backup";
+        std::filesystem::remove(backupPath);
+        auto expected = registry.view<ObjectId>().size();
+        {
+            Timer t;
+            auto [res, err] = startBackup(backupPath);
+            // Each step requeues itself behind whatever else the writer has.
+            while(res && getBackupStatus().running) dbWriter->flush();
+            if(auto status = getBackupStatus(); status.error) err = status.error;
+            if(err) {
+                fmt::print(stderr, "Backup failed: {}\n", *err);
+                return 1;
+            }
+            report("backup", t.seconds(), getBackupStatus().totalPages);
+        }
+        {
+            Timer t;
+            auto [res, err] = verifyBackup(backupPath);
+            if(!res) {
+                fmt::print(stderr, "Backup did not verify: {}\n", err.value_or("unknown reason"));
+                return 1;
+            }
+            report("verifyBackup", t.seconds(), 1);
+        }
+        {
+            // An integrity check doesn't show that the game can load it, so load it the same way.
+            auto live = std::move(db);
+            db = std::make_unique<SQLite::Database>(backupPath, SQLite::OPEN_READONLY);
+            clearWorld();
+            FlagGuard guard(gameIsLoading, true);
+            Timer t;
+            loadObjects();
+            auto loaded = registry.view<ObjectId>().size();
+            report("loadBackup", t.seconds(), loaded);
+            loaded += coldObjects.size();
+            db = std::move(live);
+            if(loaded != expected) {
+                fmt::print(stderr, "Backup loaded {} objects; expected {}.\n", loaded, expected);
+                return 1;
+            }
+        }
+        results["disk"]["backup"] = fileSize(backupPath);
+    }
+
+    {
+        clearWorld();
+        FlagGuard guard(gameIsLoading, true);
+        Timer t;
+        loadObjects();
+        report("loadObjects", t.seconds(), registry.view<ObjectId>().size());
+    }
+
+    {
+        auto ndjsonPath = dbPath + ".ndjson";
+        auto expected = registry.view<ObjectId>().size();
+        {
+            Timer t;
+            auto [count, err] = exportWorld(ndjsonPath);
+            if(err) {
+                fmt::print(stderr, "Export failed: {}\n", *err);
+                return 1;
+            }
+            report("exportWorld", t.seconds(), count);
+        }
+        results["disk"]["ndjson"] = fileSize(ndjsonPath);
+        {
+            clearWorld();
+            Timer t;
+            auto [count, err] = importObjects(ndjsonPath, false);
+            if(err || count != expected) {
+                fmt::print(stderr, "Import brought in {} of {} objects: {}\n", count, expected, err.value_or("no error"));
+                return 1;
+            }
+            report("importObjects", t.seconds(), count);
+        }
+        {
+            // A file which breaks partway through should leave nothing behind.
+            auto brokenPath = ndjsonPath + ".broken";
+            {
+                std::ifstream in(ndjsonPath);
+                std::ofstream out(brokenPath, std::ios::trunc);
+                std::string line;
+                for(std::size_t i = 0; i < expected / 2 && std::getline(in, line); i++) out << line << '\n';
+                out << "{\"id\":[0,1],\"data\":{\n";
+            }
+            Timer t;
+            auto [count, err] = importObjects(brokenPath, true);
+            auto after = registry.view<ObjectId>().size();
+            if(!err || count || after != expected) {
+                fmt::print(stderr, "Failed import left {} objects; expected {}.\n", after, expected);
+                return 1;
+            }
+            report("importRollback", t.seconds(), expected / 2 + 1);
+        }
+        // The import marked everything for saving, but it's all in the database already.
+        dirty.clear();
+        dirtyComponents.clear();
+        dirtySubEntities.clear();
+    }
+
+    {
+        // The busiest Area goes cold and comes back when something in it is looked up.
+        entt::entity zone = entt::null;
+        std::size_t most = 0;
+        for(auto ent : registry.view<Area>()) {
+            if(auto size = getContents(ent).size(); size >= most) {
+                zone = ent;
+                most = size;
+            }
+        }
+        entt::entity inside = entt::null, outside = entt::null;
+        for(auto ent : registry.view<ObjectId>()) {
+            if(isZone(ent)) continue;
+            if(getZone(ent) == zone) inside = ent;
+            else outside = ent;
+        }
+        if(registry.valid(zone) && registry.valid(inside) && registry.valid(outside)) {
+            auto expected = registry.view<ObjectId>().size();
+            auto insideId = registry.get<ObjectId>(inside);
+            // An outside Owner would lose its Assets link, so eviction must be refused.
+            setOwner(inside, outside);
+            if(auto [res, err] = evictZone(zone); res) {
+                fmt::print(stderr, "Evicted a zone with an outside owner.\n");
+                return 1;
+            }
+            setOwner(inside, entt::null);
+            {
+                Timer t;
+                auto [res, err] = evictZone(zone);
+                if(!res) {
+                    fmt::print(stderr, "Eviction failed: {}\n", err.value_or("unknown reason"));
+                    return 1;
+                }
+                report("evictZone", t.seconds(), coldObjects.size());
+            }
+            if(registry.view<ObjectId>().size() + coldObjects.size() != expected || !isObjectCold(insideId.index)) {
+                fmt::print(stderr, "Eviction lost track of objects.\n");
+                return 1;
+            }
+            {
+                auto cold = coldObjects.size();
+                Timer t;
+                inside = insideId.getObject();
+                report("hydrateZone", t.seconds(), cold);
+            }
+            auto after = registry.view<ObjectId>().size();
+            if(isZoneCold(zone) || !coldObjects.empty() || after != expected || getZone(inside) != zone) {
+                fmt::print(stderr, "Hydrating brought back {} objects; expected {}.\n", after, expected);
+                return 1;
+            }
+            if(auto [res, err] = setOwner(inside, outside); !res) {
+                fmt::print(stderr, "Could not give a hydrated object an owner: {}\n", err.value_or("unknown reason"));
+                return 1;
+            }
+            setOwner(inside, entt::null);
+        }
+    }
+    ents = allObjects();
+
+    {
+        std::vector<std::string> names;
+        for(std::size_t i = 0; i < 32 && i < ents.size(); i++) {
+            names.push_back(fmt::format("bench_proto_{}", i));
+            savePrototype(names.back(), serializeEntity(ents[ents.size() - 1 - i], true));
+        }
+        if(!names.empty()) {
+            {
+                // Every lookup goes to the database, as it did before the cache.
+                auto lookups = std::min<std::size_t>(prototypeLookups, 10000);
+                Timer t;
+                for(std::size_t i = 0; i < lookups; i++) {
+                    clearPrototypeCache();
+                    getPrototype(names[i % names.size()]);
+                }
+                report("getPrototypeUncached", t.seconds(), lookups);
+            }
+            {
+                Timer t;
+                for(std::size_t i = 0; i < prototypeLookups; i++) getPrototype(names[i % names.size()]);
+                report("getPrototype", t.seconds(), prototypeLookups);
+            }
+            {
+                Timer t;
+                auto [spawned, err] = spawnFromPrototype(names.front(), spawnCount);
+                report("spawnFromPrototype", t.seconds(), spawned.size());
+            }
+        }
+    }
+
+    results["peakRssKiB"] = peakRssKiB();
+    dbWriter->stop();
+
+    std::ofstream out(outPath, std::ios::trunc);
+    out << results.dump(4) << std::endl;
+    fmt::print(stderr, "Peak RSS {} KiB. Results written to {}.\n", results["peakRssKiB"].get<int64_t>(), outPath);
+    return 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "core/base.h"
+
+namespace core {
+
+    // The accounts and playerCharacters tables, kept in memory so that logging in, the account menu
+    // and choosing a character don't have to query them. Loaded by loadDatabase(). Times are in
+    // seconds since the epoch, as the tables store them.
+    //
+    // Bookkeeping like login times and play time is changed here first and written out in batches
+    // by flushAccountUpdates(), rather than with an UPDATE on the game strand for every login.
+
+    struct CharacterRecord {
+        int64_t character{-1};
+        int64_t account{-1};
+        int64_t lastLogin{0}, lastLogout{0};
+        double totalPlayTime{0.0};
+    };
+
+    struct AccountRecord {
+        int64_t id{-1};
+        std::string username, password, email;
+        int64_t adminLevel{0};
+        int64_t created{0}, lastLogin{0}, lastLogout{0};
+        double totalPlayTime{0.0};
+        // The objects index of each of its characters.
+        std::vector<int64_t> characters;
+    };
+
+    extern std::unordered_map<int64_t, AccountRecord> accountIndex;
+    extern std::unordered_map<int64_t, CharacterRecord> characterIndex;
+
+    // Reads both tables into the index, replacing whatever was there.
+    void loadAccounts();
+
+    AccountRecord* getAccountRecord(int64_t id);
+    // Case-insensitive in the same way as the username column's COLLATE NOCASE: only ASCII
+    // letters are folded.
+    AccountRecord* findAccountByName(std::string_view username);
+    CharacterRecord* getCharacterRecord(int64_t character);
+    // Adds an account which has just been inserted into the table.
+    AccountRecord& indexAccount(AccountRecord record);
+    // Adds a character which has just been inserted into playerCharacters, and lists it under its
+    // account. Whatever creates characters must call this, or they won't show up until restart.
+    CharacterRecord& indexCharacter(CharacterRecord record);
+
+    void recordAccountLogin(int64_t account);
+    void recordAccountLogout(int64_t account, double secondsPlayed);
+    void recordCharacterLogin(int64_t character);
+    void recordCharacterLogout(int64_t character, double secondsPlayed);
+
+    // How many accounts and characters have bookkeeping waiting to be written.
+    std::size_t pendingAccountUpdates();
+    // Hands every pending update to the dbWriter as a single transaction. If the writer isn't
+    // running, it's written inline instead.
+    void flushAccountUpdates();
+
+}
@@ -6,6 +6,59 @@
 
 namespace core {
 
+    // The entities in a relationship vector, skipping the holes left by removal and, if it has a
+    // filter, anything the filter rejects. It owns nothing and allocates nothing, and is only good
+    // until that vector changes. Anything which might move entities in or out of the holder while
+    // going over them should use a copy from getContents() and friends instead.
+    class EntityView {
+    public:
+        using Filter = const std::function<bool(entt::entity)>*;
+
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = entt::entity;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const entt::entity*;
+            using reference = entt::entity;
+
+            iterator() = default;
+            iterator(const entt::entity* pos, const entt::entity* last, Filter filter) : pos(pos), last(last), filter(filter) {
+                settle();
+            }
+            entt::entity operator*() const { return *pos; }
+            iterator& operator++() {
+                ++pos;
+                settle();
+                return *this;
+            }
+            iterator operator++(int) {
+                auto old = *this;
+                ++*this;
+                return old;
+            }
+            bool operator==(const iterator& other) const { return pos == other.pos; }
+        protected:
+            void settle() {
+                while(pos != last && (*pos == entt::null || (filter && !(*filter)(*pos)))) ++pos;
+            }
+            const entt::entity* pos{nullptr};
+            const entt::entity* last{nullptr};
+            Filter filter{nullptr};
+        };
+
+        EntityView() = default;
+        explicit EntityView(std::span<const entt::entity> data, Filter filter = nullptr) : data(data), filter(filter) {}
+        [[nodiscard]] iterator begin() const { return {data.data(), data.data() + data.size(), filter}; }
+        [[nodiscard]] iterator end() const { return {data.data() + data.size(), data.data() + data.size(), nullptr}; }
+        [[nodiscard]] bool empty() const { return begin() == end(); }
+        // A copy, for when the view won't do.
+        [[nodiscard]] std::vector<entt::entity> toVector() const { return std::vector<entt::entity>(begin(), end()); }
+    protected:
+        std::span<const entt::entity> data;
+        Filter filter{nullptr};
+    };
+
     ObjectId getObjectId(entt::entity ent);
 
     OpResult<> setParent(entt::entity ent, entt::entity target);
@@ -15,6 +68,7 @@ namespace core {
     void atChildDeleted(entt::entity ent, entt::entity target);
     void atParentDeleted(entt::entity ent, entt::entity target);
     std::vector<entt::entity> getChildren(entt::entity ent);
+    EntityView viewChildren(entt::entity ent);
 
     OpResult<> setOwner(entt::entity ent, entt::entity target);
     entt::entity getOwner(entt::entity ent);
@@ -23,6 +77,7 @@ namespace core {
     void atAssetDeleted(entt::entity ent, entt::entity target);
     void atOwnerDeleted(entt::entity ent, entt::entity target);
     std::vector<entt::entity> getAssets(entt::entity ent);
+    EntityView viewAssets(entt::entity ent);
 
     OpResult<> setLocation(entt::entity ent, entt::entity target);
     entt::entity getLocation(entt::entity ent);
@@ -31,11 +86,22 @@ namespace core {
     void atContentDeleted(entt::entity ent, entt::entity target);
     void atLocationDeleted(entt::entity ent, entt::entity target);
     std::vector<entt::entity> getContents(entt::entity ent);
+    EntityView viewContents(entt::entity ent);
+
+    // Moves all of ents into target, as setLocation() would one at a time, but checks for cycles
+    // once up front and moves nothing if any would be made. Afterwards atGroupMoved is called
+    // once for each place they left, with the ones which left it; from is entt::null for those
+    // which weren't anywhere.
+    OpResult<> moveMany(const std::vector<entt::entity>& ents, entt::entity target);
+    void defaultAtGroupMoved(entt::entity from, entt::entity to, const std::vector<entt::entity>& ents);
+    extern std::function<void(entt::entity, entt::entity, const std::vector<entt::entity>&)> atGroupMoved;
 
     template<typename T>
     void setBaseText(entt::entity ent, const std::string& txt) {
         auto &comp = registry.get_or_emplace<T>(ent);
         comp.setData(txt);
+        // Lets on_update listeners, like the component dirty tracking, know about it.
+        registry.patch<T>(ent);
     }
 
     template<typename T>
@@ -69,6 +135,23 @@ namespace core {
     void defaultAtDeleteObject(entt::entity ent);
     extern std::function<void(entt::entity)> atDeleteObject;
 
+    // Tags an object queued by deleteObject().
+    struct PendingDeletion {};
+
+    // Objects waiting for processDeletions(), in the order they were queued.
+    extern std::vector<entt::entity> pendingDeletions;
+
+    // Queues an object for deletion. It stays valid until processDeletions() runs, which
+    // ProcessDeletions does once a tick, after commands and before anything is saved.
+    void deleteObject(entt::entity ent);
+    bool isPendingDeletion(entt::entity ent);
+
+    // Deletes everything queued, calling atDeleteObject on each. The Children, Assets and Contents
+    // of whatever survives are compacted once for the whole batch, each deleted object is marked
+    // dirty once, and the entities are destroyed together. Cold zones are hydrated first. Returns
+    // how many objects were deleted.
+    std::size_t processDeletions();
+
     extern std::function<std::set<std::string>(entt::entity, entt::entity)> getSearchWords;
     std::set<std::string> defaultGetSearchWords(entt::entity ent, entt::entity looker);
 
@@ -84,6 +167,16 @@ namespace core {
     extern std::function<bool(entt::entity)> isInventory;
     bool defaultIsInventory(entt::entity ent);
 
+    // The view hooks are what Search uses. The default getInventory and getEquipment copy them,
+    // so a game only needs to replace the view hooks to change both. Search still goes through
+    // getInventory, getEquipment or getRoomContents if one of them has been replaced, but that
+    // costs a copy on every search, so overrides are better moved to the view hooks.
+    extern std::function<EntityView(entt::entity)> viewInventory;
+    EntityView defaultViewInventory(entt::entity ent);
+
+    extern std::function<EntityView(entt::entity)> viewEquipment;
+    EntityView defaultViewEquipment(entt::entity ent);
+
     extern std::function<std::vector<entt::entity>(entt::entity)> getInventory;
     std::vector<entt::entity> defaultGetInventory(entt::entity ent);
 
@@ -95,6 +188,9 @@ namespace core {
     std::optional<Destination> defaultValidDestination(entt::entity ent, const std::string& str);
     extern std::function<std::optional<Destination>(entt::entity, const std::string&)> validDestination;
 
+    EntityView defaultViewRoomContents(entt::entity ent);
+    extern std::function<EntityView(entt::entity)> viewRoomContents;
+
     std::vector<entt::entity> defaultGetRoomContents(entt::entity ent);
     extern std::function<std::vector<entt::entity>(entt::entity)> getRoomContents;
 
@@ -0,0 +1,40 @@
+#pragma once
+#include "core/database.h"
+
+namespace core {
+
+    // Online backups of the game database, using SQLite's incremental backup API. The backup reads
+    // through the DatabaseWriter's own connection, a few pages per job, with each step going to the
+    // back of the writer's queue. Saves submitted in the meantime run between steps instead of
+    // waiting for the whole copy, and whatever they write is carried into the backup as it goes.
+    // The game strand only submits the first job and reads the progress.
+    //
+    // Backups are written under a temporary name and renamed into place once complete, so a file at
+    // the final path is always a whole database.
+
+    struct BackupStatus {
+        bool running{false};
+        std::string path;
+        int totalPages{0};
+        int remainingPages{0};
+        std::size_t steps{0};
+        std::chrono::system_clock::time_point started{}, finished{};
+        // Why the last backup failed, if it did.
+        std::optional<std::string> error;
+    };
+
+    // A copy of the current or last backup's progress. Safe to call from any thread.
+    BackupStatus getBackupStatus();
+
+    // Saves everything dirty, then starts backing up to path. Refuses if a backup is already running.
+    // Without a running DatabaseWriter, the whole backup is done before this returns.
+    OpResult<> startBackup(const std::string& path);
+
+    // The path config::dbBackupName expands to for the current time.
+    std::string makeBackupPath();
+
+    // Opens a finished backup and runs SQLite's integrity check over it. This doesn't load it;
+    // coremud_bench does that with loadObjects() after each backup it takes.
+    OpResult<> verifyBackup(const std::string& path);
+
+}
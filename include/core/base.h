@@ -12,14 +12,23 @@
 #include <map>
 #include <set>
 #include <unordered_map>
+#include <array>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <utility>
 #include <random>
 #include <unordered_set>
 #include <bitset>
+#include <bit>
+#include <span>
 #include <variant>
 #include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
 
 // Our own libraries...
 #include <boost/asio.hpp>
@@ -98,8 +107,8 @@ namespace core {
         ObjectId(std::size_t index, int64_t generation) : index(index), generation(generation) {};
 
         explicit ObjectId(const nlohmann::json &json) : index(json[0]), generation(json[1]) {};
-        std::size_t index;
-        int64_t generation;
+        std::size_t index{0};
+        int64_t generation{0};
 
         [[nodiscard]] std::string toString() const;
 
@@ -144,9 +153,74 @@ namespace std {
 }
 
 namespace core {
-// Any object which needs to be updated in the database - it was created, modified, or deleted,
+    // A set of ObjectIds kept as a bitmap over the objects arena, with the generation and an
+    // optional bitmask stored alongside each set bit. Marking is O(1) and allocates only when the
+    // arena has grown past anything marked before. Iteration scans a word at a time, skipping
+    // 64 clean slots at once.
+    //
+    // A deleted object's slot can be handed out again before the set is processed. If an index is
+    // marked under a new generation while still marked under an old one, the old ObjectId is set
+    // aside rather than lost, so its deletion still gets saved.
+    class DirtySet {
+    public:
+        class const_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = ObjectId;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const ObjectId*;
+            using reference = ObjectId;
+
+            const_iterator() = default;
+            ObjectId operator*() const;
+            const_iterator& operator++();
+            const_iterator operator++(int);
+            bool operator==(const const_iterator& other) const = default;
+        protected:
+            friend class DirtySet;
+            const_iterator(const DirtySet* set, std::size_t pos);
+            // Moves pos forward to the next marked entry, or to the end.
+            void settle();
+            const DirtySet* set{nullptr};
+            // Set-aside entries come first, then one position per bit.
+            std::size_t pos{0};
+        };
+
+        // Marks id, ORing mask into its bitmask. Returns false if it was already marked.
+        bool insert(const ObjectId& id, uint64_t mask = 0);
+        [[nodiscard]] bool contains(const ObjectId& id) const;
+        // The bitmask of a marked id, or 0.
+        [[nodiscard]] uint64_t mask(const ObjectId& id) const;
+        // Unmarks id. Returns false if it wasn't marked.
+        bool erase(const ObjectId& id);
+        void clear();
+        [[nodiscard]] std::size_t size() const { return count; }
+        [[nodiscard]] bool empty() const { return count == 0; }
+        [[nodiscard]] const_iterator begin() const;
+        [[nodiscard]] const_iterator end() const;
+    protected:
+        struct Slot {
+            int64_t generation{0};
+            uint64_t mask{0};
+        };
+        struct SetAside {
+            ObjectId id;
+            uint64_t mask{0};
+        };
+        [[nodiscard]] bool isMarked(std::size_t index) const;
+        std::vector<uint64_t> words;
+        std::vector<Slot> slots;
+        std::vector<SetAside> setAside;
+        std::size_t count{0};
+    };
+
+    // Any object which needs to be updated in the database - it was created, modified, or deleted,
     // its ObjectId must be in the dirty set by the time the syncer runs.
-    extern std::unordered_set<ObjectId> dirty;
+    extern DirtySet dirty;
+
+    // Objects which only need some of their components saved. Each one's mask is a bitmask of
+    // indexes into componentSerializers. An object which is also in dirty gets a full save instead.
+    extern DirtySet dirtyComponents;
 
     // If this is set, many operations which would set the dirty flag will not.
     // Other safeguards of the Object API may also be released. Do remember to
@@ -155,6 +229,7 @@ namespace core {
 
     void setDirty(entt::entity, bool override = false);
     void setDirty(const ObjectId& id, bool override = false);
+    void setComponentsDirty(const ObjectId& id, uint64_t mask, bool override = false);
 
     entt::entity getObject(std::size_t index, int64_t generation);
     entt::entity getObject(std::size_t index);
@@ -162,27 +237,126 @@ namespace core {
     using RoomId = std::size_t;
 
     // The objects vector serves as a generational arena for all objects in the game.
-    // The first element of the pair is the generation (as a unix timestamp in seconds),
-    // the second is the object itself.
+    // The first element of the pair is the generation, the second is the object itself.
+    // Generations only ever go up: see nextObjectGeneration(). A slot keeps its last
+    // generation after its object is gone, so that the next one there gets a higher one.
     // A grave is an object with a generation of 0 and an empty pointer.
     // We COULD get away with just using a vector of shared_ptrs, but this way we can
     // use the ObjectId for serialization and not have to worry about the object being
     // deleted and the ID being reused.
     extern std::vector<std::pair<int64_t, entt::entity>> objects;
 
+    // Objects which are in the database but not the registry, because the zone they're in is
+    // cold (see zone.h). Their slot in objects keeps its generation but has no entity. The key is
+    // the index into objects, and the value is the zone's ObjectId, so that a zone which has since
+    // been deleted and had its slot reused isn't mistaken for it.
+    extern std::unordered_map<std::size_t, ObjectId> coldObjects;
+    // True if the object at index exists but isn't loaded. getObject() will load it.
+    bool isObjectCold(std::size_t index);
+    // Called by getObject() for a cold index. Should load the object and return true if it did.
+    extern std::function<bool(std::size_t)> warmObject;
+
+    // A free slot in objects. Freed slots are kept on a free list, and slots nobody has looked
+    // at yet are found by a cursor that only moves forward, so this is amortized O(1).
     std::size_t getFreeObjectId();
+    // Connected to the registry's on_destroy<ObjectId> by watchComponents(); puts the slot on
+    // the free list.
+    void onObjectIdDestroyed(entt::registry& reg, entt::entity ent);
+    // Forgets the free list and starts looking from the front of objects again. Called once
+    // objects has been filled in some way other than createObject(), as by loadDatabase().
+    void resetFreeObjectIds();
 
     int64_t getUnixTimestamp();
 
+    // The highest generation handed out or loaded so far.
+    extern int64_t lastObjectGeneration;
+    // A generation for a new object at index: higher than any given out before, and than the
+    // slot's last one. It starts from the current unix time, like the generations of older
+    // databases, so that those stay valid.
+    int64_t nextObjectGeneration(std::size_t index);
+    // Makes sure no generation at or below gen is handed out again.
+    void noteObjectGeneration(int64_t gen);
+
     ObjectId createObjectId();
 
     entt::entity createObject();
 
-    extern std::unordered_set<std::string> stringPool;
+    // Creates count objects at once, with the entities and their ObjectIds made in bulk.
+    std::vector<entt::entity> createObjects(std::size_t count);
+
+    struct InternStats {
+        // Distinct strings held, and the bytes of text in them.
+        std::size_t unique{0};
+        std::size_t bytes{0};
+        // Arena memory reserved, and how much of that is in freed slots waiting to be reused.
+        std::size_t arenaBytes{0};
+        std::size_t freeBytes{0};
+        uint64_t lookups{0};
+        uint64_t hits{0};
+    };
+
+    // Deduplicated, reference-counted strings. Each string lives in an arena slot with its reference
+    // count just in front of it, so retaining and releasing a view costs no lookup. Slots come in
+    // power-of-two size classes; a freed slot is reused by the next string of its class, and never
+    // moves, so views stay valid for as long as they hold a reference. Not thread-safe; it belongs
+    // to the game strand.
+    class InternTable {
+    public:
+        InternTable() = default;
+        InternTable(const InternTable&) = delete;
+        InternTable& operator=(const InternTable&) = delete;
+        // Returns the table's copy of str with a reference taken. An empty string isn't stored.
+        std::string_view acquire(std::string_view str);
+        // Takes another reference to a view returned by acquire().
+        void retain(std::string_view str);
+        // Drops a reference to a view returned by acquire(). The last one frees the string.
+        void release(std::string_view str);
+        [[nodiscard]] InternStats stats() const;
+    protected:
+        struct Header {
+            uint32_t refs;
+            uint32_t sizeClass;
+        };
+        static constexpr std::size_t blockSize = 256 * 1024;
+        static constexpr std::size_t minSlot = 16;
+        // Slots bigger than this are allocated on their own.
+        static constexpr uint32_t largeClass = 15;
+        static Header* headerOf(std::string_view str);
+        char* allocate(std::size_t size, uint32_t& sizeClass);
+        std::unordered_map<std::string_view, Header*> strings;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::unordered_map<const Header*, std::unique_ptr<char[]>> large;
+        std::array<std::vector<char*>, largeClass> freeSlots{};
+        std::size_t blockUsed{blockSize};
+        InternStats counters;
+    };
+
+    extern InternTable stringPool;
 
+    // Interns str for good: the reference taken is never released. StringView manages its own.
     std::string_view intern(const std::string& str);
     std::string_view intern(std::string_view str);
 
+    // Splits [0, count) into contiguous ranges and runs func(begin, end) on each using a
+    // temporary pool of threads, blocking until all are done. If threads < 1, one per core.
+    // The first exception thrown by any range is rethrown here.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)>& func, int threads = 0);
+
+    // FNV-1a. Only meant to catch torn or corrupted files, not tampering.
+    uint64_t checksum64(const void* data, std::size_t size);
+
+    // Sets a flag for the lifetime of the guard, then puts back whatever was there before.
+    class FlagGuard {
+    public:
+        FlagGuard(bool& flag, bool value) : flag(flag), old(flag) { flag = value; }
+        ~FlagGuard() { flag = old; }
+        FlagGuard(const FlagGuard&) = delete;
+        FlagGuard& operator=(const FlagGuard&) = delete;
+    protected:
+        bool& flag;
+        bool old;
+    };
+
     extern std::random_device randomDevice;
     extern std::default_random_engine randomEngine;
 
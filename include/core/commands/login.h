@@ -15,5 +15,34 @@ namespace core::cmd {
         void execute(const std::shared_ptr<Connection>& connection, std::unordered_map<std::string, std::string>& input) override;
     };
 
+    // Starts an online backup, or shows how the current one is going. Admins only.
+    struct LoginCommandBackup : LoginCommand {
+        std::string getCmdName() override { return "backup"; };
+        [[nodiscard]] bool isAvailable(const std::shared_ptr<Connection>& connection) override;
+        void execute(const std::shared_ptr<Connection>& connection, std::unordered_map<std::string, std::string>& input) override;
+    };
+
+    // export <file> writes the whole world as NDJSON; export <file> <#zone> writes one zone and
+    // everything in it. Admins only.
+    struct LoginCommandExport : LoginCommand {
+        std::string getCmdName() override { return "export"; };
+        [[nodiscard]] bool isAvailable(const std::shared_ptr<Connection>& connection) override;
+        void execute(const std::shared_ptr<Connection>& connection, std::unordered_map<std::string, std::string>& input) override;
+    };
+
+    // import <file> loads NDJSON objects into free slots; import <file> keep keeps their ids. Admins only.
+    struct LoginCommandImport : LoginCommand {
+        std::string getCmdName() override { return "import"; };
+        [[nodiscard]] bool isAvailable(const std::shared_ptr<Connection>& connection) override;
+        void execute(const std::shared_ptr<Connection>& connection, std::unordered_map<std::string, std::string>& input) override;
+    };
+
+    // Shows how much the string pool holds and how often lookups find an existing string. Admins only.
+    struct LoginCommandStrings : LoginCommand {
+        std::string getCmdName() override { return "strings"; };
+        [[nodiscard]] bool isAvailable(const std::shared_ptr<Connection>& connection) override;
+        void execute(const std::shared_ptr<Connection>& connection, std::unordered_map<std::string, std::string>& input) override;
+    };
+
     void registerLoginCommands();
 }
\ No newline at end of file
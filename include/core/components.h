@@ -5,9 +5,16 @@
 
 namespace core {
 
+    // Text held in the stringPool. Each copy holds its own references, which are released when
+    // it's destroyed or given new text.
     struct StringView {
         StringView() = default;
         explicit StringView(const std::string& txt) { setData(txt); };
+        StringView(const StringView& other);
+        StringView(StringView&& other) noexcept;
+        StringView& operator=(const StringView& other);
+        StringView& operator=(StringView&& other) noexcept;
+        ~StringView();
         std::string_view data;
         std::string_view clean;
         void setData(const std::string& txt);
@@ -28,10 +35,20 @@ namespace core {
 
     struct Entity {
         entt::entity data{entt::null};
+        // Where this entity sits in data's ReverseEntity, so that it can be removed without a
+        // search. Not saved; it's rebuilt as relationships are.
+        std::size_t slot{0};
     };
 
+    // The other side of a relationship: Contents for Location, Children for Parent, and Assets
+    // for Owner. Removing an entity leaves entt::null in its place, so that removal is O(1) and
+    // everything else keeps its order. The holes are squeezed out once they make up half of data.
+    // Use the functions in api.h rather than changing data directly.
     struct ReverseEntity {
         std::vector<entt::entity> data{};
+        std::size_t holes{0};
+        [[nodiscard]] std::size_t size() const { return data.size() - holes; }
+        [[nodiscard]] bool empty() const { return size() == 0; }
     };
 
     struct Location : Entity {
@@ -74,6 +91,23 @@ namespace core {
         RoomId id;
     };
 
+    // The kinds of entities which live inside of an Object rather than being Objects themselves.
+    // These numbers are stored in the database; never renumber them.
+    enum class SubEntityKind : uint8_t {
+        Room = 0,
+        ExpansePoi = 1,
+        MapPoi = 2,
+        SpacePoi = 3
+    };
+
+    // Meant to be used by the entt::entity within the poi map of an Expanse, Map or Space.
+    // Like Room, it points back to the Object that holds it.
+    struct PointOfInterest {
+        ObjectId obj;
+        SubEntityKind kind{SubEntityKind::ExpansePoi};
+        DestinationType point;
+    };
+
     struct RoomLocation {
         RoomId id;
     };
@@ -22,4 +22,56 @@ namespace core::config {
     extern boost::asio::ip::tcp::endpoint thermiteEndpoint;
     // the filename for the game save database.
     extern std::string dbName;
+
+    // SQLite storage profile. These are applied as PRAGMAs by readyDatabase().
+    // The journal mode. WAL is strongly recommended; it turns commits into sequential appends.
+    extern std::string dbJournalMode;
+    // The synchronous level. NORMAL is durable across application crashes when used with WAL.
+    extern std::string dbSynchronous;
+    // The page cache size. Negative values are in KiB, positive values are in pages.
+    extern int64_t dbCacheSize;
+    // The maximum number of bytes of the database file to memory-map. 0 disables mmap.
+    extern int64_t dbMmapSize;
+    // processDirty() commits in transactions of at most this many objects.
+    extern std::size_t dbSaveChunkSize;
+    // If true, objects are saved as MessagePack. If false, as compact JSON text.
+    // Either kind of row can always be loaded.
+    extern bool dbBinaryObjects;
+    // The number of threads loadObjects() parses rows with. If <1, one per core.
+    extern int dbLoadThreads;
+    // The world snapshot written at shutdown and preferred by loadDatabase() when it's current.
+    // Set to empty to disable snapshots.
+    extern std::string dbSnapshotName;
+    // The append-only save journal. If empty, saves are written straight to the objects table.
+    extern std::string dbJournalName;
+    // The journal is folded into the objects table once it grows past this many bytes...
+    extern uint64_t dbJournalCompactBytes;
+    // ...or this long after the last compaction, whichever comes first.
+    extern std::chrono::seconds dbJournalCompactInterval;
+    // If true, the ProcessCheckpoint system saves dirty objects a little every tick.
+    extern bool checkpointIncremental;
+    // How long ProcessCheckpoint may spend snapshotting each tick...
+    extern std::chrono::microseconds checkpointTimeBudget;
+    // ...and roughly how many bytes it may snapshot. 0 means no byte limit.
+    extern std::size_t checkpointByteBudget;
+    // If above 0, every checkpoint epoch is finished within this many ticks, even if that means
+    // going over budget.
+    extern std::size_t checkpointEpochTicks;
+    // If true, loadDatabase() leaves every zone's rooms and contents in the database until
+    // something needs them. See zone.h.
+    extern bool dbLazyZones;
+    // A zone with no players in it for this long is saved and evicted. 0 disables eviction.
+    extern std::chrono::seconds zoneIdleTimeout;
+    // How often to look for idle zones.
+    extern std::chrono::seconds zoneCheckInterval;
+    // How often account and character bookkeeping, like login times, is written out.
+    extern std::chrono::seconds accountFlushInterval;
+    // Where online backups are written. {} is replaced with the unix time the backup started.
+    extern std::string dbBackupName;
+    // How many pages each step of a backup copies. Smaller steps let saves in sooner.
+    extern int dbBackupPagesPerStep;
+    // How often to start a backup on its own. 0 leaves it to the backup command.
+    extern std::chrono::seconds dbBackupInterval;
+    // How many objects NDJSON import and export hold in memory at once. See ndjson.h.
+    extern std::size_t dbTransferChunkSize;
 }
\ No newline at end of file
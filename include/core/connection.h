@@ -72,6 +72,8 @@ namespace core {
         // These probably need some updating on this and Thermite side...
         std::chrono::system_clock::time_point connected{};
         std::chrono::steady_clock::time_point connectedSteady{}, lastActivity{}, lastMsg{};
+        // When this connection logged in to its account.
+        std::chrono::steady_clock::time_point loggedIn{};
 
         // This is embedded for ease of segmentation but this struct isn't
         // actually used anywhere else.
@@ -93,6 +95,8 @@ namespace core {
     extern std::vector<std::function<OpResult<>(std::string_view, int64_t)>> accountUsernameValidators;
     OpResult<> validateAccountUsername(std::string_view username, int64_t id);
     OpResult<> validatePlayerCharacterName(std::string_view name, ObjectId id);
+    // Inserts the account and indexes it. The INSERT goes through the dbWriter like every other
+    // write, but the id is needed straight away, so this blocks until the writer has caught up.
     OpResult<int64_t> createAccount(std::string_view username, std::string_view password);
 
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include "core/base.h"
+
+namespace core {
+
+    // The Location tree, indexed so that "is this inside that" and "what is this ultimately in" are
+    // O(1). Every entity in the tree is labelled with an interval from an Euler tour of its root's
+    // subtree: an entity is inside another exactly when its interval is nested in the other's.
+    //
+    // Intervals are handed out with room to spare, in proportion to the size of what's put in
+    // them, so that moving something only labels the moved subtree, from the gap left at the end
+    // of its new container's interval. Whatever leaves last gives its interval back. When a gap
+    // runs out, the nearest container with enough room for its whole subtree is laid out again,
+    // which reclaims everything left behind in it.
+    // setLocation() and moveMany() keep it up to date; nothing else needs to, except bulk loads.
+    struct Containment {
+        // The outermost container; the entity itself if it isn't located anywhere.
+        entt::entity root{entt::null};
+        // How many Locations lie between it and root.
+        uint32_t depth{0};
+        uint64_t enter{0}, exit{0};
+        // Where the next thing put inside of it will be labelled from.
+        uint64_t nextFree{0};
+    };
+
+    // While set, setLocation() and moveMany() leave the index alone, and check for cycles by walking
+    // up Locations instead. Loading sets it, then labels everything it placed in one pass with
+    // rebuildContainment().
+    extern bool deferContainment;
+
+    // Relabels ent and everything inside of it after its Location changed.
+    void updateContainment(entt::entity ent);
+
+    // Gives ent's interval back to its container, if nothing was put in after it. Called just
+    // before ent leaves.
+    void leaveContainment(entt::entity ent);
+
+    // Labels every Location tree from scratch.
+    void rebuildContainment();
+    // Labels ents and everything inside of them, after they were placed with the index deferred.
+    void rebuildContainment(const std::vector<entt::entity>& ents);
+
+    // True if ent is located in container, however deeply. Nothing is inside itself.
+    bool isInside(entt::entity ent, entt::entity container);
+
+    // The outermost thing ent is located in, or entt::null if it isn't located anywhere.
+    entt::entity getRootLocation(entt::entity ent);
+
+    // How many Locations lie between ent and its root location.
+    std::size_t getLocationDepth(entt::entity ent);
+
+}
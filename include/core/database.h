@@ -1,11 +1,65 @@
 #pragma once
 #include "core/base.h"
+#include "core/components.h"
 
 
 namespace core {
 
     extern std::unique_ptr<SQLite::Database> db;
 
+    // A statement borrowed from a StatementCache. It's handed out with its bindings cleared,
+    // and reset when it goes out of scope, so that an abandoned SELECT doesn't hold a read open.
+    class CachedStatement {
+    public:
+        CachedStatement(SQLite::Statement* statement, bool* inUse) : statement(statement), inUse(inUse) {};
+        explicit CachedStatement(std::unique_ptr<SQLite::Statement> owned) : statement(owned.get()), owned(std::move(owned)) {};
+        CachedStatement(CachedStatement&& other) noexcept;
+        CachedStatement& operator=(CachedStatement&& other) = delete;
+        ~CachedStatement();
+        SQLite::Statement* operator->() { return statement; };
+        SQLite::Statement& operator*() { return *statement; };
+    protected:
+        SQLite::Statement* statement{nullptr};
+        bool* inUse{nullptr};
+        std::unique_ptr<SQLite::Statement> owned;
+    };
+
+    // Prepared statements for one connection, keyed by their SQL text, so that each is only parsed
+    // and planned once. A cache belongs to whichever thread is using its connection.
+    class StatementCache {
+    public:
+        explicit StatementCache(SQLite::Database& conn) : conn(conn) {};
+        // If the statement for sql is already borrowed, by a caller further up the stack, a
+        // private one is prepared instead and counted as a miss.
+        CachedStatement get(std::string_view sql);
+        void clear();
+        [[nodiscard]] uint64_t getHits() const { return hits.load(std::memory_order_relaxed); };
+        [[nodiscard]] uint64_t getMisses() const { return misses.load(std::memory_order_relaxed); };
+        [[nodiscard]] std::size_t size() const { return statements.size(); };
+    protected:
+        struct Entry {
+            std::unique_ptr<SQLite::Statement> statement;
+            bool inUse{false};
+        };
+        struct SqlHash {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view sql) const { return std::hash<std::string_view>()(sql); };
+        };
+        SQLite::Database& conn;
+        std::unordered_map<std::string, Entry, SqlHash, std::equal_to<>> statements;
+        std::atomic<uint64_t> hits{0}, misses{0};
+    };
+
+    // The cache for a connection, created on first use.
+    StatementCache& getStatementCache(SQLite::Database& conn);
+    // Finalizes a connection's cached statements. Must be called before the connection is closed.
+    void dropStatementCache(SQLite::Database& conn);
+    // Shorthand for getStatementCache(conn).get(sql).
+    CachedStatement prepare(SQLite::Database& conn, std::string_view sql);
+    // Totals over every connection's cache.
+    uint64_t getStatementCacheHits();
+    uint64_t getStatementCacheMisses();
+
     extern std::vector<std::string> schema;
 
     template<size_t N>
@@ -28,17 +82,307 @@ namespace core {
         }
     }
 
+    // Every row in objects is tagged with the format of its data column, so that
+    // old and new rows can live side by side. Never renumber these.
+    enum class ObjectFormat : uint8_t {
+        JsonText = 0,
+        MsgPack = 1
+    };
+
+    // The format that new rows will be written in, according to config::dbBinaryObjects.
+    ObjectFormat getObjectFormat();
+    std::vector<uint8_t> encodeObject(const nlohmann::json& j, ObjectFormat format);
+    nlohmann::json decodeObject(ObjectFormat format, const void* data, std::size_t size);
+
+    // Each top-level key of an entity's json is owned by one ComponentSerializer, which knows
+    // how to save it from the entity and load it back. Since every key can be written on its own,
+    // they are also the unit of delta persistence: see setComponentDirty().
+    struct ComponentSerializer {
+        std::string key;
+        // Writes j[key] if the entity has the component. Must write nothing otherwise.
+        std::function<void(entt::entity, bool, nlohmann::json&)> save;
+        // Called with j[key] if it is present.
+        std::function<void(entt::entity, const nlohmann::json&)> load;
+        // Optional, for serializeEntities(). Walks the component's storage in order, and for
+        // every entity that recordFor returns a json for, writes [key] into it as save() would.
+        std::function<void(bool, const std::function<nlohmann::json*(entt::entity)>&)> saveAll;
+        // Optional, alongside saveAll: how many entities have the component.
+        std::function<std::size_t()> count;
+        // Optional, for prototypes. Decodes j once, and returns a function which gives the decoded
+        // component to many entities at once. Components which refer to other entities, or own
+        // entities of their own, can't be shared like that and must leave this empty.
+        std::function<std::function<void(const std::vector<entt::entity>&)>(const nlohmann::json&)> compile;
+    };
+
+    // Builds a ComponentSerializer for the component type T out of a typed encoder and a decoder.
+    // The encoder fills in the json stored under key; if it leaves it null, nothing is stored.
+    template<typename T>
+    ComponentSerializer makeComponentSerializer(std::string key,
+            std::function<void(entt::entity, const T&, bool, nlohmann::json&)> encode,
+            std::function<void(entt::entity, const nlohmann::json&)> decode) {
+        ComponentSerializer out;
+        out.key = key;
+        out.save = [key, encode](entt::entity ent, bool asPrototype, nlohmann::json& j) {
+            auto comp = registry.try_get<T>(ent);
+            if(!comp) return;
+            nlohmann::json value;
+            encode(ent, *comp, asPrototype, value);
+            if(!value.is_null()) j[key] = std::move(value);
+        };
+        out.load = std::move(decode);
+        out.saveAll = [key, encode](bool asPrototype, const std::function<nlohmann::json*(entt::entity)>& recordFor) {
+            for(auto [ent, comp] : registry.view<T>().each()) {
+                auto j = recordFor(ent);
+                if(!j) continue;
+                nlohmann::json value;
+                encode(ent, comp, asPrototype, value);
+                if(!value.is_null()) (*j)[key] = std::move(value);
+            }
+        };
+        out.count = []() { return registry.storage<T>().size(); };
+        if constexpr (std::is_copy_constructible_v<T>) {
+            // The decoder only knows how to emplace onto an entity, so it's run on a scratch one
+            // and the result copied off.
+            out.compile = [load = out.load](const nlohmann::json& j) -> std::function<void(const std::vector<entt::entity>&)> {
+                auto scratch = registry.create();
+                load(scratch, j);
+                auto comp = registry.try_get<T>(scratch);
+                std::optional<T> value;
+                if(comp) value.emplace(*comp);
+                registry.destroy(scratch);
+                if(!value) return {};
+                return [value = std::move(*value)](const std::vector<entt::entity>& ents) {
+                    registry.insert<T>(ents.begin(), ents.end(), value);
+                };
+            };
+        }
+        return out;
+    }
+
+    // For empty tag components, which are saved as true.
+    template<typename T>
+    ComponentSerializer makeTagSerializer(std::string key) {
+        ComponentSerializer out;
+        out.key = key;
+        out.save = [key](entt::entity ent, bool asPrototype, nlohmann::json& j) {
+            if(registry.all_of<T>(ent)) j[key] = true;
+        };
+        out.load = [](entt::entity ent, const nlohmann::json& j) {
+            registry.get_or_emplace<T>(ent);
+        };
+        out.saveAll = [key](bool asPrototype, const std::function<nlohmann::json*(entt::entity)>& recordFor) {
+            for(auto ent : registry.view<T>()) {
+                if(auto j = recordFor(ent)) (*j)[key] = true;
+            }
+        };
+        out.count = []() { return registry.storage<T>().size(); };
+        out.compile = [](const nlohmann::json& j) -> std::function<void(const std::vector<entt::entity>&)> {
+            return [](const std::vector<entt::entity>& ents) {
+                registry.insert<T>(ents.begin(), ents.end());
+            };
+        };
+        return out;
+    }
+
+    // Ordered; deserialization follows this order. Only the first 64 can be tracked
+    // individually; changes to any others cause a full save.
+    extern std::vector<ComponentSerializer> componentSerializers;
+    // Replaces an existing serializer with the same key, or appends it. Returns its index.
+    std::size_t registerComponentSerializer(ComponentSerializer serializer);
+
+    template<typename T>
+    std::size_t registerComponent(std::string key,
+            std::function<void(entt::entity, const T&, bool, nlohmann::json&)> encode,
+            std::function<void(entt::entity, const nlohmann::json&)> decode) {
+        return registerComponentSerializer(makeComponentSerializer<T>(std::move(key), std::move(encode), std::move(decode)));
+    }
+    std::optional<std::size_t> getComponentSerializerIndex(std::string_view key);
+    // The json for a single key, or empty if the entity doesn't have that component.
+    std::optional<nlohmann::json> serializeComponent(entt::entity ent, std::size_t index, bool asPrototype = false);
+
+    void markComponentDirty(entt::entity ent, std::size_t index);
+    // Marks only the given key of an object for saving. Unknown keys mark the whole object.
+    void setComponentDirty(entt::entity ent, std::string_view key);
+
+    template<typename T>
+    inline std::size_t watchedComponentIndex = std::numeric_limits<std::size_t>::max();
+
+    template<typename T>
+    void onWatchedComponentChanged(entt::registry& reg, entt::entity ent) {
+        markComponentDirty(ent, watchedComponentIndex<T>);
+    }
+
+    // Hooks the registry's construct/update/destroy signals for T, so that any change made
+    // through emplace, patch, replace, or remove dirties the key that T is saved under.
+    template<typename T>
+    void watchComponent(std::string_view key) {
+        auto idx = getComponentSerializerIndex(key);
+        if(!idx) return;
+        watchedComponentIndex<T> = *idx;
+        registry.on_construct<T>().template connect<&onWatchedComponentChanged<T>>();
+        registry.on_update<T>().template connect<&onWatchedComponentChanged<T>>();
+        registry.on_destroy<T>().template connect<&onWatchedComponentChanged<T>>();
+    }
+
+    // Watches all of the built-in components. Called by readyDatabase().
+    void watchComponents();
+
     extern std::vector<std::function<void(entt::entity,bool, nlohmann::json& j)>> serializeFuncs;
 
-    nlohmann::json serializeEntity(entt::entity ent, bool asPrototype = false);
+    // If withSubEntities is false, the Rooms of an Area and the points of interest of an
+    // Expanse/Map/Space are left out; the objects table stores those as their own rows.
+    nlohmann::json serializeEntity(entt::entity ent, bool asPrototype = false, bool withSubEntities = true);
+
+    // Serializes many entities at once, in the same order as ents. Every serializer with a saveAll
+    // walks its component's storage a single time and scatters into the results, rather than being
+    // asked about each entity in turn. If only a few of its components belong to ents, probing them
+    // one by one is cheaper, so that is done instead. filter, if given, picks which serializers run.
+    std::vector<nlohmann::json> serializeEntities(const std::vector<entt::entity>& ents, bool asPrototype = false,
+            bool withSubEntities = true, const std::function<bool(const ComponentSerializer&)>& filter = {});
+
+    // Identifies a Room or point of interest by the Object which holds it and its place there.
+    struct SubEntityKey {
+        ObjectId owner;
+        SubEntityKind kind{SubEntityKind::Room};
+        DestinationType point;
+        bool operator==(const SubEntityKey& other) const = default;
+    };
+
+}
+
+namespace std {
+    template<>
+    struct hash<core::SubEntityKey> {
+        size_t operator()(const core::SubEntityKey& key) const {
+            return std::hash<core::ObjectId>()(key.owner) ^ (std::hash<core::DestinationType>()(key.point) << 2) ^ static_cast<size_t>(key.kind);
+        }
+    };
+}
+
+namespace core {
+
+    // Rooms and points of interest which need their rows saved, or deleted if they're gone.
+    extern std::unordered_set<SubEntityKey> dirtySubEntities;
+    // The key of a Room or point of interest entity, if it is one.
+    std::optional<SubEntityKey> getSubEntityKey(entt::entity ent);
+    // Looks up a Room or point of interest in its owner. entt::null if it's not there.
+    entt::entity findSubEntity(const SubEntityKey& key);
+    // The form of a Room's id or a point's coordinates used in the object_subentities table.
+    std::string subEntityKeyString(const DestinationType& point);
+    void setSubEntityDirty(entt::entity ent, bool override = false);
 
     extern std::vector<std::function<void(entt::entity, const nlohmann::json&)>> deserializeFuncs;
     void deserializeEntity(entt::entity ent, const nlohmann::json& j);
 
+    // A snapshot of a single dirty object, taken on the game strand by processDirty().
+    // If data is set, it's the whole object. Otherwise, if components is non-empty, only those
+    // keys changed; an empty value means the component was removed. subEntities carries any
+    // Rooms or points of interest of the object which changed, with empty meaning removed.
+    // If none of those are set, the object has been deleted and all of its rows will be removed.
+    struct ObjectSnapshot {
+        ObjectId id;
+        std::optional<nlohmann::json> data;
+        std::vector<std::pair<std::string, std::optional<nlohmann::json>>> components;
+        std::vector<std::tuple<SubEntityKind, std::string, std::optional<nlohmann::json>>> subEntities;
+        // Where the object is, for zone loading: the index of its Location, or -1, and whether it's
+        // a zone itself. Not meaningful for a deletion.
+        int64_t location{-1};
+        bool isZone{false};
+        [[nodiscard]] bool isDeletion() const { return !data && components.empty() && subEntities.empty(); }
+    };
+
+    // Reported back to the game strand once the writer has finished a batch.
+    struct SaveResult {
+        uint64_t batch{0};
+        std::size_t saved{0};
+        std::size_t fragments{0};
+        std::size_t deleted{0};
+        std::size_t subEntities{0};
+        double seconds{0.0};
+        std::optional<std::string> error;
+    };
+
+    // The DatabaseWriter owns a dedicated thread with its own connection to the game database.
+    // Jobs are executed strictly in the order they were submitted. Nothing in a Job may touch
+    // the registry; everything it needs must be captured by value.
+    class DatabaseWriter {
+    public:
+        using Job = std::function<void(SQLite::Database&)>;
+        ~DatabaseWriter();
+        void start();
+        // Finishes all pending jobs, then joins the thread.
+        void stop();
+        void submit(Job job);
+        // Blocks until every job submitted so far has been executed.
+        void flush();
+        [[nodiscard]] std::size_t pending();
+        [[nodiscard]] bool isRunning() const { return running; };
+
+        // Called by the writer thread when a batch finishes. Safe to call from any thread.
+        void reportResult(SaveResult result);
+        // Hands over all results reported since the last call. Meant for the game strand.
+        std::vector<SaveResult> takeResults();
+
+    protected:
+        void run();
+        std::unique_ptr<SQLite::Database> conn;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wake, idle;
+        std::deque<Job> jobs;
+        std::vector<SaveResult> results;
+        bool stopping{false};
+        bool busy{false};
+        bool running{false};
+    };
+
+    extern std::unique_ptr<DatabaseWriter> dbWriter;
+
+    // Writes a batch of snapshots to the objects table in chunked transactions.
+    // Runs on the writer thread, but is usable on any connection.
+    SaveResult writeSnapshots(SQLite::Database& conn, std::vector<ObjectSnapshot>& batch);
+
+    // Takes snapshots of every dirty object and hands them to the dbWriter. If the writer
+    // isn't running, the batch is written inline instead.
     void processDirty();
 
+    // The pieces of processDirty(), for saving a little at a time. Each takes one entry out of
+    // its dirty set and appends its snapshot to batch. They return roughly how many bytes were
+    // snapshotted, or 0 if the entry wasn't dirty anymore.
+    std::size_t snapshotDirtyObject(const ObjectId& obj, std::vector<ObjectSnapshot>& batch);
+    std::size_t snapshotDirtySubEntity(const SubEntityKey& key, std::vector<ObjectSnapshot>& batch);
+    // Hands a batch to the journal or the writer, or writes it inline if neither is running.
+    // Returns the batch id its SaveResult will carry.
+    uint64_t submitSnapshots(std::vector<ObjectSnapshot> batch);
+
+    // A full checkpoint: marks every loaded object dirty, then saves them all through processDirty().
+    void saveAllObjects();
+
+    // Called on the game strand with every SaveResult the writer has reported.
+    extern std::vector<std::function<void(const SaveResult&)>> saveResultFuncs;
+    void processSaveResults();
+
+    // Applies the config::db* storage profile (journal mode, synchronous, cache and mmap sizes).
+    void applyStoragePragmas(SQLite::Database& conn);
+
+    // Brings the tables of an older database up to the current schema.
+    void upgradeSchema();
+
     void readyDatabase();
 
+    // Offline migration: re-encodes every objects row that isn't already in the given format.
+    // Meant to be run between readyDatabase() and loadDatabase(). Returns the number of rows converted.
+    std::size_t migrateObjects(ObjectFormat format);
+
+    // The number of transactions that have written to objects. See the meta table.
+    int64_t getSaveEpoch(SQLite::Database& conn);
+
+    // Reads and hydrates every cold object in a zone, and the zone's rooms and points of interest.
+    // Returns the number of objects loaded. Used by hydrateZone().
+    std::size_t loadZoneContents(entt::entity zone);
+
+    // Loads from the snapshot at config::dbSnapshotName if it's current, else from the tables.
+    // With config::dbLazyZones, loading from the tables leaves zones cold.
     void loadDatabase();
 
     extern std::vector<std::function<void()>> preLoadFuncs, postLoadFuncs;
@@ -46,6 +390,7 @@ namespace core {
 
     void savePrototype(const std::string& name, const nlohmann::json& j);
 
+    // Served from the prototype cache. See prototype.h.
     std::optional<nlohmann::json> getPrototype(const std::string &name);
 
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+#include "core/database.h"
+
+namespace core {
+
+    // The Journal is an append-only log of saved object snapshots. processDirty() appends to it
+    // instead of writing the objects table directly, so a save costs one sequential write and
+    // one fsync no matter how many objects it touches. A compactor on the DatabaseWriter thread
+    // periodically folds the journal into the objects table and truncates it.
+    //
+    // Each record is: uint32 payload size, uint64 checksum of the payload, then a MessagePack
+    // payload describing one ObjectSnapshot. A torn record at the end of the file is ignored.
+    class Journal {
+    public:
+        explicit Journal(std::string path);
+        ~Journal();
+        // Appends every snapshot in the batch. Nothing is durable until sync().
+        void append(const std::vector<ObjectSnapshot>& batch);
+        void sync();
+        void truncate();
+        [[nodiscard]] uint64_t size() const { return bytes; };
+        [[nodiscard]] const std::string& getPath() const { return path; };
+
+        // Reads the valid prefix of the journal at path.
+        static std::vector<ObjectSnapshot> read(const std::string& path);
+
+    protected:
+        void open();
+        std::string path;
+        int fd{-1};
+        uint64_t bytes{0};
+    };
+
+    // Folds a stream of snapshots down to one per object, so that compaction writes each object once.
+    class SnapshotCoalescer {
+    public:
+        void add(ObjectSnapshot snap);
+        std::vector<ObjectSnapshot> take();
+        [[nodiscard]] bool empty() const { return order.empty(); };
+    protected:
+        std::unordered_map<ObjectId, std::size_t> index;
+        std::vector<ObjectSnapshot> order;
+    };
+
+    extern std::unique_ptr<Journal> journal;
+
+    // Game strand: hands a batch to the journal. Batches queued while the writer is busy are
+    // appended together and share a single fsync.
+    void submitToJournal(std::vector<ObjectSnapshot> batch, uint64_t batchId);
+
+    // Writer thread: folds everything journaled so far into the objects table, then truncates.
+    void compactJournal(SQLite::Database& conn);
+
+    // Startup: writes whatever a previous run left in the journal into the objects table, before
+    // anything is loaded. Returns the number of snapshots replayed.
+    std::size_t recoverJournal();
+
+    // Submits everything dirty and, if journaling, a compaction, then waits for the writer.
+    // Afterwards, the objects table reflects the world as it is right now.
+    void checkpointDatabase();
+
+    // Waits for the writer to finish what it's already been given, compacting the journal after
+    // it. Nothing new is submitted from the game strand, so it's safe to call in the middle of a
+    // lookup.
+    void awaitWriter();
+
+}
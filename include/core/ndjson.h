@@ -0,0 +1,41 @@
+#pragma once
+#include "core/database.h"
+
+namespace core {
+
+    // Streaming world import and export, one object per line:
+    //
+    //   {"id":[index,generation],"data":{...}}
+    //
+    // data is serializeEntity() with Rooms and points of interest nested, so a file stands on its own.
+    // Both directions work in chunks of config::dbTransferChunkSize objects, so memory use doesn't
+    // grow with the file. Only the table of ids grows with it, while importing. Encoding and parsing run
+    // on a worker pool; only the registry work is done on the calling thread.
+
+    using ObjectIdRemap = std::unordered_map<ObjectId, ObjectId>;
+
+    // Rewrites an [index, generation] array in place if it's in remap. References to objects that
+    // weren't imported are left alone.
+    void remapObjectIdJson(nlohmann::json& j, const ObjectIdRemap& remap);
+
+    // Called while importing with remapping, on every object's json and every nested Room or point
+    // of interest's json, to rewrite any ObjectIds they hold. Location, Parent, Owner and Room are
+    // handled already. May run on any thread, and must not touch the registry.
+    extern std::vector<std::function<void(nlohmann::json&, const ObjectIdRemap&)>> importRemapFuncs;
+
+    // Writes ents to path. The file is written under a temporary name and renamed into place.
+    // Returns how many objects were written.
+    OpResult<std::size_t> exportObjects(const std::string& path, const std::vector<entt::entity>& ents);
+    // A zone and everything located in it, however deeply. Cold zones are hydrated first.
+    OpResult<std::size_t> exportZone(const std::string& path, entt::entity zone);
+    // Every object. Hydrates every cold zone first.
+    OpResult<std::size_t> exportWorld(const std::string& path);
+
+    // Reads objects from path, creates them, and marks them for saving. If remap is true, every
+    // object gets a new id in a free slot and references among them are rewritten to match.
+    // Otherwise they keep the ids in the file, and the import is refused if any of those is taken.
+    // Returns how many objects were imported. If any line fails to parse or load, every object
+    // created by the import is deleted again, and nothing is imported.
+    OpResult<std::size_t> importObjects(const std::string& path, bool remap = true);
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "core/database.h"
+
+namespace core {
+
+    // Prototypes are read from the prototypes table once, and kept compiled: every component with a
+    // ComponentSerializer::compile is decoded a single time, and spawning gives that value to all
+    // of the copies with one bulk registry insert. savePrototype() drops the cached entry.
+
+    struct CompiledPrototype {
+        std::string name;
+        nlohmann::json data;
+        // In componentSerializers order, then deserializeFuncs. Each applies to every entity given.
+        std::vector<std::function<void(const std::vector<entt::entity>&)>> steps;
+    };
+
+    // Loads and compiles the prototype if it isn't cached yet. nullptr if there's no such prototype.
+    std::shared_ptr<const CompiledPrototype> getCompiledPrototype(const std::string& name);
+    void invalidatePrototype(const std::string& name);
+    // Drops every cached prototype. Called whenever componentSerializers change.
+    void clearPrototypeCache();
+
+    // Creates count new objects from a prototype, all of them marked for saving.
+    OpResult<std::vector<entt::entity>> spawnFromPrototype(const std::string& name, std::size_t count = 1);
+
+}
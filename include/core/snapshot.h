@@ -0,0 +1,24 @@
+#pragma once
+#include "core/base.h"
+
+namespace core {
+
+    // A world snapshot is a flat binary image of the objects arena and the built-in components,
+    // written at shutdown or checkpoint time and memory-mapped at startup so that loadDatabase()
+    // can skip decoding every row. It is never the source of truth: it records the database's
+    // save epoch at the time it was taken, and is ignored unless that still matches.
+    //
+    // The file uses the host's byte order and is not meant to be moved between machines.
+
+    // Written into the file header. Bump it whenever the layout changes.
+    constexpr uint32_t snapshotVersion = 1;
+
+    // Flushes all pending saves, then writes a snapshot of the whole world to path.
+    // The file is written under a temporary name and renamed into place.
+    OpResult<> writeSnapshot(const std::string& path);
+
+    // Attempts to hydrate the world from the snapshot at path. Returns false, without touching
+    // the registry, if the file is missing, corrupt, from another version, or out of date.
+    OpResult<> loadSnapshot(const std::string& path);
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "core/base.h"
+#include "core/database.h"
 
 namespace core {
 
@@ -32,6 +33,83 @@ namespace core {
         async<void> run(double deltaTime) override;
     };
 
+    // Carries out the deleteObject() calls made during the tick, all at once. See processDeletions().
+    class ProcessDeletions : public System {
+    public:
+        std::string getName() override {return "ProcessDeletions";};
+        int64_t getPriority() override {return 5000;};
+        async<void> run(double deltaTime) override;
+    };
+
+    // Relays the results of background saves back to the game strand, and flushes account
+    // bookkeeping every config::accountFlushInterval.
+    class ProcessDatabase : public System {
+    public:
+        std::string getName() override {return "ProcessDatabase";};
+        int64_t getPriority() override {return 9000;};
+        async<void> run(double deltaTime) override;
+    protected:
+        double sinceAccountFlush{0.0};
+    };
+
+    // What ProcessCheckpoint has been up to, updated every tick it runs.
+    struct CheckpointMetrics {
+        // The checkpoint epoch being worked on, and how many of its entries are left.
+        uint64_t epoch{0};
+        std::size_t epochRemaining{0};
+        // Everything dirty, whether it's in the current epoch or waiting for the next.
+        std::size_t backlog{0};
+        std::size_t savedLastTick{0};
+        std::size_t bytesLastTick{0};
+        // Entries saved per second, smoothed over recent ticks.
+        double drainRate{0.0};
+        // Ticks spent on the current epoch so far, and on the last one to finish.
+        std::size_t epochTicks{0};
+        std::size_t lastEpochTicks{0};
+    };
+    extern CheckpointMetrics checkpointMetrics;
+
+    // Saves dirty objects a little every tick, so that nobody pays for processDirty() all at once.
+    // Work is done in epochs: an epoch covers everything dirty at the moment it starts, and the
+    // next doesn't start until it's finished. Each tick saves until config::checkpointTimeBudget
+    // or config::checkpointByteBudget is spent. If config::checkpointEpochTicks is set, each tick
+    // also saves at least enough to finish the epoch within that many ticks, budget or not.
+    class ProcessCheckpoint : public System {
+    public:
+        std::string getName() override {return "ProcessCheckpoint";};
+        int64_t getPriority() override {return 8500;};
+        async<bool> shouldRun(double deltaTime) override;
+        async<void> run(double deltaTime) override;
+    protected:
+        void startEpoch();
+        [[nodiscard]] std::size_t epochRemaining() const;
+        std::vector<ObjectId> epochObjects;
+        std::vector<SubEntityKey> epochSubEntities;
+        std::size_t objectCursor{0}, subEntityCursor{0};
+    };
+
+    // Keeps track of which zones have players in them, and evicts the ones which have gone idle.
+    class ProcessZones : public System {
+    public:
+        std::string getName() override {return "ProcessZones";};
+        int64_t getPriority() override {return 8000;};
+        async<bool> shouldRun(double deltaTime) override;
+        async<void> run(double deltaTime) override;
+    protected:
+        double elapsed{0.0};
+    };
+
+    // Starts an online backup every config::dbBackupInterval. See backup.h.
+    class ProcessBackups : public System {
+    public:
+        std::string getName() override {return "ProcessBackups";};
+        int64_t getPriority() override {return 7500;};
+        async<bool> shouldRun(double deltaTime) override;
+        async<void> run(double deltaTime) override;
+    protected:
+        double elapsed{0.0};
+    };
+
     class ProcessCommands : public System {
     public:
         std::string getName() override {return "ProcessCommands";};
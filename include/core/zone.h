@@ -0,0 +1,57 @@
+#pragma once
+#include "core/database.h"
+
+namespace core {
+
+    // A zone is an Object with an Area, Expanse, Map or Space. A zone may be hot, with its rooms,
+    // points of interest and everything located in it loaded into the registry, or cold, with all of
+    // that left in the database. The zone Object itself is always loaded, so that exits and
+    // Destinations pointing at it keep working.
+    //
+    // With config::dbLazyZones, every zone starts out cold and is hydrated the first time something
+    // enters it, looks at its contents, or asks getObject() for something inside it. Hot zones
+    // which have had no players in them for config::zoneIdleTimeout are saved and evicted.
+
+    // Tags a zone whose contents are not in the registry.
+    struct ColdZone {};
+
+    // When a hot zone last had a player in it.
+    struct ZoneActivity {
+        std::chrono::steady_clock::time_point lastActive{std::chrono::steady_clock::now()};
+        // Set once the zone has been evicted during this run. Its rows might still be waiting
+        // on the writer, so hydrating it again must wait for it first.
+        bool evicted{false};
+    };
+
+    // The cold objects in each cold zone, keyed by the zone's index. The inverse of coldObjects.
+    extern std::unordered_map<std::size_t, std::vector<std::size_t>> coldZoneContents;
+
+    bool isZone(entt::entity ent);
+    bool isZoneCold(entt::entity zone);
+
+    // Follows Location up to the zone that ent is in. A zone is not in itself.
+    entt::entity getZone(entt::entity ent);
+
+    // Marks an Object as being in a cold zone. Used while loading.
+    void setObjectCold(std::size_t index, int64_t generation, const ObjectId& zone);
+
+    // Loads a cold zone's contents back into the registry. Does nothing if it's hot.
+    extern std::function<void(entt::entity)> hydrateZone;
+
+    // If ent is a cold zone, hydrates it.
+    void ensureHydrated(entt::entity ent);
+
+    // Moves a zone's rooms and points of interest into out, leaving the zone without any.
+    void collectSubEntities(entt::entity zone, std::vector<entt::entity>& out);
+
+    // Saves a zone's contents and removes them from the registry. Refuses if a player or a session
+    // is inside, or if anything inside is Parented or Owned across the zone's edge, either way.
+    extern std::function<OpResult<>(entt::entity)> evictZone;
+
+    // Refreshes the ZoneActivity of every zone with a player in it.
+    void updateZoneActivity();
+
+    // Evicts every hot zone idle for longer than config::zoneIdleTimeout. Returns how many.
+    std::size_t evictIdleZones();
+
+}
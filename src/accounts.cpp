@@ -0,0 +1,181 @@
+#include "core/accounts.h"
+#include "core/database.h"
+
+namespace core {
+
+    std::unordered_map<int64_t, AccountRecord> accountIndex;
+    std::unordered_map<int64_t, CharacterRecord> characterIndex;
+
+    // Usernames folded to lowercase, to account ids.
+    static std::unordered_map<std::string, int64_t> accountsByName;
+    static std::unordered_set<int64_t> dirtyAccounts, dirtyCharacters;
+
+    static std::string foldUsername(std::string_view username) {
+        std::string out(username);
+        for(auto &c : out) {
+            if(c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        return out;
+    }
+
+    static int64_t unixNow() {
+        return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    void loadAccounts() {
+        accountIndex.clear();
+        characterIndex.clear();
+        accountsByName.clear();
+        dirtyAccounts.clear();
+        dirtyCharacters.clear();
+
+        SQLite::Statement q1(*db, "SELECT id, username, password, email, adminLevel, created, lastLogin, lastLogout, totalPlayTime FROM accounts;");
+        while(q1.executeStep()) {
+            AccountRecord record;
+            record.id = q1.getColumn(0).getInt64();
+            record.username = q1.getColumn(1).getString();
+            record.password = q1.getColumn(2).getString();
+            record.email = q1.getColumn(3).getString();
+            record.adminLevel = q1.getColumn(4).getInt64();
+            record.created = q1.getColumn(5).getInt64();
+            record.lastLogin = q1.getColumn(6).getInt64();
+            record.lastLogout = q1.getColumn(7).getInt64();
+            record.totalPlayTime = q1.getColumn(8).getDouble();
+            indexAccount(std::move(record));
+        }
+
+        SQLite::Statement q2(*db, "SELECT character, account, lastLogin, lastLogout, totalPlayTime FROM playerCharacters ORDER BY rowid;");
+        while(q2.executeStep()) {
+            CharacterRecord record;
+            record.character = q2.getColumn(0).getInt64();
+            record.account = q2.getColumn(1).getInt64();
+            record.lastLogin = q2.getColumn(2).getInt64();
+            record.lastLogout = q2.getColumn(3).getInt64();
+            record.totalPlayTime = q2.getColumn(4).getDouble();
+            indexCharacter(record);
+        }
+        logger->info("Indexed {} accounts and {} characters.", accountIndex.size(), characterIndex.size());
+    }
+
+    AccountRecord* getAccountRecord(int64_t id) {
+        auto found = accountIndex.find(id);
+        return found == accountIndex.end() ? nullptr : &found->second;
+    }
+
+    AccountRecord* findAccountByName(std::string_view username) {
+        auto found = accountsByName.find(foldUsername(username));
+        return found == accountsByName.end() ? nullptr : getAccountRecord(found->second);
+    }
+
+    CharacterRecord* getCharacterRecord(int64_t character) {
+        auto found = characterIndex.find(character);
+        return found == characterIndex.end() ? nullptr : &found->second;
+    }
+
+    AccountRecord& indexAccount(AccountRecord record) {
+        accountsByName[foldUsername(record.username)] = record.id;
+        auto id = record.id;
+        return accountIndex[id] = std::move(record);
+    }
+
+    CharacterRecord& indexCharacter(CharacterRecord record) {
+        if(auto acc = getAccountRecord(record.account)) {
+            auto &chars = acc->characters;
+            if(std::find(chars.begin(), chars.end(), record.character) == chars.end()) chars.push_back(record.character);
+        }
+        return characterIndex[record.character] = record;
+    }
+
+    void recordAccountLogin(int64_t account) {
+        auto acc = getAccountRecord(account);
+        if(!acc) return;
+        acc->lastLogin = unixNow();
+        dirtyAccounts.insert(account);
+    }
+
+    void recordAccountLogout(int64_t account, double secondsPlayed) {
+        auto acc = getAccountRecord(account);
+        if(!acc) return;
+        acc->lastLogout = unixNow();
+        acc->totalPlayTime += secondsPlayed;
+        dirtyAccounts.insert(account);
+    }
+
+    void recordCharacterLogin(int64_t character) {
+        auto rec = getCharacterRecord(character);
+        if(!rec) return;
+        rec->lastLogin = unixNow();
+        dirtyCharacters.insert(character);
+    }
+
+    void recordCharacterLogout(int64_t character, double secondsPlayed) {
+        auto rec = getCharacterRecord(character);
+        if(!rec) return;
+        rec->lastLogout = unixNow();
+        rec->totalPlayTime += secondsPlayed;
+        dirtyCharacters.insert(character);
+    }
+
+    std::size_t pendingAccountUpdates() {
+        return dirtyAccounts.size() + dirtyCharacters.size();
+    }
+
+    // The bookkeeping columns of one row, copied off of the game strand.
+    struct AccountUpdate {
+        int64_t id{-1};
+        int64_t lastLogin{0}, lastLogout{0};
+        double totalPlayTime{0.0};
+    };
+
+    static void writeAccountUpdates(SQLite::Database& conn, const std::vector<AccountUpdate>& accounts,
+                                    const std::vector<AccountUpdate>& characters) {
+        SQLite::Transaction trans(conn);
+        auto q1 = prepare(conn, "UPDATE accounts SET lastLogin = ?, lastLogout = ?, totalPlayTime = ? WHERE id = ?;");
+        for(auto &u : accounts) {
+            q1->bind(1, u.lastLogin);
+            q1->bind(2, u.lastLogout);
+            q1->bind(3, u.totalPlayTime);
+            q1->bind(4, u.id);
+            q1->exec();
+            q1->reset();
+        }
+        auto q2 = prepare(conn, "UPDATE playerCharacters SET lastLogin = ?, lastLogout = ?, totalPlayTime = ? WHERE character = ?;");
+        for(auto &u : characters) {
+            q2->bind(1, u.lastLogin);
+            q2->bind(2, u.lastLogout);
+            q2->bind(3, u.totalPlayTime);
+            q2->bind(4, u.id);
+            q2->exec();
+            q2->reset();
+        }
+        trans.commit();
+    }
+
+    void flushAccountUpdates() {
+        if(dirtyAccounts.empty() && dirtyCharacters.empty()) return;
+        std::vector<AccountUpdate> accounts, characters;
+        accounts.reserve(dirtyAccounts.size());
+        characters.reserve(dirtyCharacters.size());
+        for(auto id : dirtyAccounts) {
+            if(auto acc = getAccountRecord(id)) accounts.push_back({id, acc->lastLogin, acc->lastLogout, acc->totalPlayTime});
+        }
+        for(auto id : dirtyCharacters) {
+            if(auto rec = getCharacterRecord(id)) characters.push_back({id, rec->lastLogin, rec->lastLogout, rec->totalPlayTime});
+        }
+        dirtyAccounts.clear();
+        dirtyCharacters.clear();
+
+        if(dbWriter && dbWriter->isRunning()) {
+            dbWriter->submit([accounts = std::move(accounts), characters = std::move(characters)](SQLite::Database& conn) {
+                writeAccountUpdates(conn, accounts, characters);
+            });
+            return;
+        }
+        try {
+            writeAccountUpdates(*db, accounts, characters);
+        } catch(std::exception& e) {
+            logger->error("Could not write account updates: {}", e.what());
+        }
+    }
+
+}
@@ -1,6 +1,8 @@
 #include "core/api.h"
 #include "core/components.h"
 #include "core/color.h"
+#include "core/zone.h"
+#include "core/containment.h"
 
 namespace core {
 
@@ -107,9 +109,10 @@ namespace core {
         }
 
         if(registry.valid(target)) {
-            addToChildren(target, ent);
             auto &par = registry.get_or_emplace<Parent>(ent);
             par.data = target;
+            addToChildren(target, ent);
+            registry.patch<Parent>(ent);
         } else {
             registry.remove<Parent>(ent);
         }
@@ -124,27 +127,87 @@ namespace core {
         return entt::null;
     }
 
-    void addToChildren(entt::entity ent, entt::entity child) {
-        if(registry.valid(ent)) {
-            auto &children = registry.get_or_emplace<Children>(ent);
-            children.data.push_back(child);
+    // Below this many holes, a ReverseEntity isn't worth compacting.
+    static constexpr std::size_t minReverseHoles = 16;
+
+    // Squeezes the holes out of rev, which belongs to holder, and tells each member's Fwd
+    // where it now sits.
+    template<typename Fwd>
+    static void compactReverse(entt::entity holder, ReverseEntity& rev) {
+        std::erase_if(rev.data, [](auto e) { return e == entt::null; });
+        rev.holes = 0;
+        for(std::size_t i = 0; i < rev.data.size(); i++) {
+            if(auto fwd = registry.try_get<Fwd>(rev.data[i]); fwd && fwd->data == holder) fwd->slot = i;
         }
     }
 
-    void removeFromChildren(entt::entity ent, entt::entity child) {
-        if(registry.valid(ent)) {
-            auto &children = registry.get_or_emplace<Children>(ent);
-            children.data.erase(std::remove(children.data.begin(), children.data.end(), child), children.data.end());
+    // Adds child to holder's Rev, recording where in child's Fwd, if it has one yet.
+    template<typename Rev, typename Fwd>
+    static void addReverse(entt::entity holder, entt::entity child) {
+        if(!registry.valid(holder)) return;
+        auto &rev = registry.get_or_emplace<Rev>(holder);
+        if(auto fwd = registry.try_get<Fwd>(child)) fwd->slot = rev.data.size();
+        rev.data.push_back(child);
+    }
+
+    template<typename Rev, typename Fwd>
+    static void removeReverse(entt::entity holder, entt::entity child) {
+        if(!registry.valid(holder)) return;
+        auto rev = registry.try_get<Rev>(holder);
+        if(!rev) return;
+        auto &data = rev->data;
+        std::size_t slot;
+        if(auto fwd = registry.try_get<Fwd>(child); fwd && fwd->slot < data.size() && data[fwd->slot] == child) {
+            slot = fwd->slot;
+        } else {
+            // Added without a Fwd pointing back, so its slot was never recorded.
+            slot = std::find(data.begin(), data.end(), child) - data.begin();
+            if(slot == data.size()) return;
+        }
+        data[slot] = entt::null;
+        rev->holes++;
+        // Holes at the end needn't wait for a compaction.
+        while(!data.empty() && data.back() == entt::null) {
+            data.pop_back();
+            rev->holes--;
         }
+        if(rev->holes >= minReverseHoles && rev->holes * 2 >= data.size()) compactReverse<Fwd>(holder, *rev);
     }
 
-    std::vector<entt::entity> getChildren(entt::entity ent) {
-        if(registry.valid(ent)) {
-            if(auto children = registry.try_get<Children>(ent)) {
-                return children->data;
+    template<typename Rev>
+    static EntityView viewReverse(entt::entity holder) {
+        if(!registry.valid(holder)) return {};
+        if(auto rev = registry.try_get<Rev>(holder)) return EntityView(rev->data);
+        return {};
+    }
+
+    template<typename Rev>
+    static std::vector<entt::entity> copyReverse(entt::entity holder) {
+        std::vector<entt::entity> out;
+        if(!registry.valid(holder)) return out;
+        if(auto rev = registry.try_get<Rev>(holder)) {
+            out.reserve(rev->size());
+            for(auto e : rev->data) {
+                if(e != entt::null) out.push_back(e);
             }
         }
-        return {};
+        return out;
+    }
+
+    void addToChildren(entt::entity ent, entt::entity child) {
+        addReverse<Children, Parent>(ent, child);
+    }
+
+    void removeFromChildren(entt::entity ent, entt::entity child) {
+        removeReverse<Children, Parent>(ent, child);
+    }
+
+    std::vector<entt::entity> getChildren(entt::entity ent) {
+        return copyReverse<Children>(ent);
+    }
+
+    EntityView viewChildren(entt::entity ent) {
+        return viewReverse<Children>(ent);
     }
 
     void atChildDeleted(entt::entity ent, entt::entity target) {
@@ -173,9 +236,10 @@ namespace core {
         }
 
         if(registry.valid(target)) {
-            addToAssets(target, ent);
             auto &par = registry.get_or_emplace<Owner>(ent);
             par.data = target;
+            addToAssets(target, ent);
+            registry.patch<Owner>(ent);
         } else {
             registry.remove<Owner>(ent);
         }
@@ -191,26 +255,19 @@ namespace core {
     }
 
     void addToAssets(entt::entity ent, entt::entity child) {
-        if(registry.valid(ent)) {
-            auto &children = registry.get_or_emplace<Assets>(ent);
-            children.data.push_back(child);
-        }
+        addReverse<Assets, Owner>(ent, child);
     }
 
     void removeFromAssets(entt::entity ent, entt::entity child) {
-        if(registry.valid(ent)) {
-            auto &children = registry.get_or_emplace<Assets>(ent);
-            children.data.erase(std::remove(children.data.begin(), children.data.end(), child), children.data.end());
-        }
+        removeReverse<Assets, Owner>(ent, child);
     }
 
     std::vector<entt::entity> getAssets(entt::entity ent) {
-        if(registry.valid(ent)) {
-            if(auto children = registry.try_get<Assets>(ent)) {
-                return children->data;
-            }
-        }
-        return {};
+        return copyReverse<Assets>(ent);
+    }
+
+    EntityView viewAssets(entt::entity ent) {
+        return viewReverse<Assets>(ent);
     }
 
     void atAssetDeleted(entt::entity ent, entt::entity target) {
@@ -221,30 +278,39 @@ namespace core {
         setOwner(ent, entt::null);
     }
 
+    // True if putting ent in target would put it inside itself.
+    static bool wouldContainItself(entt::entity ent, entt::entity target) {
+        if(target == ent) return true;
+        // The containment index answers this without walking up from target, unless it's deferred.
+        if(!deferContainment) return isInside(target, ent);
+        for(auto loc = getLocation(target); registry.valid(loc); loc = getLocation(loc)) {
+            if(loc == ent) return true;
+        }
+        return false;
+    }
+
     OpResult<> setLocation(entt::entity ent, entt::entity target) {
-        if(registry.valid(target)) {
-            // We must look up the parent chain to ensure no shenanigans.
-            auto parent = target;
-            while(registry.valid(parent)) {
-                if(parent == ent) {
-                    return {false, "That would cause a recursive relationship... very bad."};
-                }
-                parent = getLocation(parent);
-            }
+        // Entering a cold zone loads it. While loading, it's only being put back where it was.
+        if(!gameIsLoading) ensureHydrated(target);
+        if(registry.valid(target) && wouldContainItself(ent, target)) {
+            return {false, "That would cause a recursive relationship... very bad."};
         }
 
         entt::entity oldLocation = getLocation(ent);
         if(registry.valid(oldLocation)) {
+            if(!deferContainment) leaveContainment(ent);
             removeFromContents(oldLocation, ent);
         }
 
         if(registry.valid(target)) {
-            addToContents(target, ent);
             auto &par = registry.get_or_emplace<Location>(ent);
             par.data = target;
+            addToContents(target, ent);
+            registry.patch<Location>(ent);
         } else {
             registry.remove<Location>(ent);
         }
+        if(!deferContainment) updateContainment(ent);
         return {true, std::nullopt};
 
     }
@@ -257,26 +323,68 @@ namespace core {
     }
 
     void addToContents(entt::entity ent, entt::entity child) {
-        if(registry.valid(ent)) {
-            auto &children = registry.get_or_emplace<Contents>(ent);
-            children.data.push_back(child);
-        }
+        addReverse<Contents, Location>(ent, child);
     }
 
     void removeFromContents(entt::entity ent, entt::entity child) {
-        if(registry.valid(ent)) {
-            auto &children = registry.get_or_emplace<Contents>(ent);
-            children.data.erase(std::remove(children.data.begin(), children.data.end(), child), children.data.end());
-        }
+        removeReverse<Contents, Location>(ent, child);
     }
 
     std::vector<entt::entity> getContents(entt::entity ent) {
-        if(registry.valid(ent)) {
-            if(auto children = registry.try_get<Contents>(ent)) {
-                return children->data;
+        if(!gameIsLoading) ensureHydrated(ent);
+        return copyReverse<Contents>(ent);
+    }
+
+    EntityView viewContents(entt::entity ent) {
+        if(!gameIsLoading) ensureHydrated(ent);
+        return viewReverse<Contents>(ent);
+    }
+
+    void defaultAtGroupMoved(entt::entity from, entt::entity to, const std::vector<entt::entity>& ents) {
+
+    }
+    std::function<void(entt::entity, entt::entity, const std::vector<entt::entity>&)> atGroupMoved = defaultAtGroupMoved;
+
+    OpResult<> moveMany(const std::vector<entt::entity>& ents, entt::entity target) {
+        if(!gameIsLoading) ensureHydrated(target);
+        if(!registry.valid(target)) return {false, "There is nowhere to move them to."};
+        // Moving things into target doesn't change what target is in, so one pass settles it.
+        for(auto ent : ents) {
+            if(!registry.valid(ent)) return {false, "Something being moved doesn't exist."};
+            if(wouldContainItself(ent, target)) {
+                return {false, "That would cause a recursive relationship... very bad."};
             }
         }
-        return {};
+
+        // In the order each source was first seen. There are rarely more than a few.
+        std::vector<std::pair<entt::entity, std::vector<entt::entity>>> sources;
+        std::vector<entt::entity> moved;
+        moved.reserve(ents.size());
+        std::unordered_set<entt::entity> seen;
+        auto &arrivals = registry.get_or_emplace<Contents>(target);
+        arrivals.data.reserve(arrivals.data.size() + ents.size());
+        for(auto ent : ents) {
+            if(!seen.insert(ent).second) continue;
+            auto from = getLocation(ent);
+            auto group = std::find_if(sources.begin(), sources.end(), [&](auto &s) { return s.first == from; });
+            if(group == sources.end()) group = sources.emplace(sources.end(), from, std::vector<entt::entity>{});
+            group->second.push_back(ent);
+
+            if(registry.valid(from)) {
+                if(!deferContainment) leaveContainment(ent);
+                removeFromContents(from, ent);
+            }
+            auto &par = registry.get_or_emplace<Location>(ent);
+            par.data = target;
+            addToContents(target, ent);
+            registry.patch<Location>(ent);
+            moved.push_back(ent);
+        }
+        // Once everything is in place, they're labelled together from what's left of target's interval.
+        if(!deferContainment) rebuildContainment(moved);
+
+        for(auto &[from, group] : sources) atGroupMoved(from, target, group);
+        return {true, std::nullopt};
     }
 
     void atContentDeleted(entt::entity ent, entt::entity target) {
@@ -293,34 +401,132 @@ namespace core {
         // routine, but we need a failsafe for any stragglers.
     }
 
+    // Set while processDeletions() runs. Rather than each deleted object removing itself from its
+    // holders' vectors, the holders are noted and compacted once at the end.
+    static struct {
+        bool active{false};
+        std::unordered_set<entt::entity> parents, owners, locations;
+    } deletionBatch;
+
     void defaultAtDeleteObject(entt::entity ent) {
-        if(auto par = registry.try_get<Parent>(ent)) {
-            atChildDeleted(par->data, ent);
+        if(!deletionBatch.active) {
+            if(auto par = registry.try_get<Parent>(ent)) {
+                atChildDeleted(par->data, ent);
+            }
+            // Each of these removes the child from ent's vector, so they go over a copy.
+            for(auto child : getChildren(ent)) {
+                atParentDeleted(child, ent);
+            }
+            if(auto par = registry.try_get<Owner>(ent)) {
+                atAssetDeleted(par->data, ent);
+            }
+            for(auto child : getAssets(ent)) {
+                atOwnerDeleted(child, ent);
+            }
+            if(auto par = registry.try_get<Location>(ent)) {
+                atContentDeleted(par->data, ent);
+            }
+            for(auto child : copyReverse<Contents>(ent)) {
+                atLocationDeleted(child, ent);
+            }
+            return;
+        }
+
+        // Holders which are being deleted too don't need compacting, and neither do the
+        // relationships of children which are. ent's own vectors go away with it, so its
+        // surviving children only need their side cleared.
+        if(auto par = registry.try_get<Parent>(ent); par && !isPendingDeletion(par->data)) {
+            deletionBatch.parents.insert(par->data);
         }
         if(auto par = registry.try_get<Children>(ent)) {
             for(auto child : par->data) {
-                atParentDeleted(child, ent);
+                if(registry.valid(child) && !isPendingDeletion(child)) registry.remove<Parent>(child);
             }
         }
-        if(auto par = registry.try_get<Owner>(ent)) {
-            atAssetDeleted(par->data, ent);
+        if(auto par = registry.try_get<Owner>(ent); par && !isPendingDeletion(par->data)) {
+            deletionBatch.owners.insert(par->data);
         }
         if(auto par = registry.try_get<Assets>(ent)) {
             for(auto child : par->data) {
-                atOwnerDeleted(child, ent);
+                if(registry.valid(child) && !isPendingDeletion(child)) registry.remove<Owner>(child);
             }
         }
-        if(auto par = registry.try_get<Location>(ent)) {
-            atContentDeleted(par->data, ent);
+        if(auto par = registry.try_get<Location>(ent); par && !isPendingDeletion(par->data)) {
+            deletionBatch.locations.insert(par->data);
         }
         if(auto par = registry.try_get<Contents>(ent)) {
             for(auto child : par->data) {
-                atLocationDeleted(child, ent);
+                if(!registry.valid(child) || isPendingDeletion(child)) continue;
+                registry.remove<Location, GridLocation, RoomLocation, SectorLocation>(child);
+                updateContainment(child);
             }
         }
     }
     std::function<void(entt::entity)> atDeleteObject = defaultAtDeleteObject;
 
+    std::vector<entt::entity> pendingDeletions;
+
+    void deleteObject(entt::entity ent) {
+        if(!registry.valid(ent) || isPendingDeletion(ent)) return;
+        registry.emplace<PendingDeletion>(ent);
+        pendingDeletions.push_back(ent);
+    }
+
+    bool isPendingDeletion(entt::entity ent) {
+        return registry.valid(ent) && registry.all_of<PendingDeletion>(ent);
+    }
+
+    template<typename Rev, typename Fwd>
+    static void compactHolders(const std::unordered_set<entt::entity>& holders) {
+        for(auto holder : holders) {
+            auto rev = registry.try_get<Rev>(holder);
+            if(!rev) continue;
+            for(auto &e : rev->data) {
+                if(e != entt::null && isPendingDeletion(e)) e = entt::null;
+            }
+            compactReverse<Fwd>(holder, *rev);
+        }
+    }
+
+    std::size_t processDeletions() {
+        std::size_t deleted = 0;
+        // An atDeleteObject hook may queue more; those make a batch of their own.
+        while(!pendingDeletions.empty()) {
+            auto batch = std::move(pendingDeletions);
+            pendingDeletions.clear();
+
+            // A cold zone's contents and rows are only known once it's loaded. Deleting it as it
+            // is would leave them stranded, so it's brought in first and they're unlocated
+            // like any other zone's.
+            for(auto ent : batch) ensureHydrated(ent);
+
+            deletionBatch.active = true;
+            for(auto ent : batch) atDeleteObject(ent);
+            deletionBatch.active = false;
+            compactHolders<Children, Parent>(deletionBatch.parents);
+            compactHolders<Assets, Owner>(deletionBatch.owners);
+            compactHolders<Contents, Location>(deletionBatch.locations);
+            deletionBatch.parents.clear();
+            deletionBatch.owners.clear();
+            deletionBatch.locations.clear();
+
+            std::vector<entt::entity> subs;
+            for(auto ent : batch) {
+                if(auto id = registry.try_get<ObjectId>(ent)) setDirty(*id);
+                if(isZone(ent)) collectSubEntities(ent, subs);
+            }
+            // Their ObjectId slots go back on the free list as they're destroyed.
+            registry.destroy(batch.begin(), batch.end());
+            // Owners first, so that destroying these doesn't mark them dirty; the owner's
+            // deletion takes its sub-entity rows with it.
+            for(auto sub : subs) {
+                if(registry.valid(sub)) registry.destroy(sub);
+            }
+            deleted += batch.size();
+        }
+        return deleted;
+    }
+
     std::set<std::string> defaultGetSearchWords(entt::entity ent, entt::entity looker) {
         auto name = stripAnsi(getDisplayName(ent, looker));
         std::set<std::string> words;
@@ -362,29 +568,35 @@ namespace core {
     }
     std::function<bool(entt::entity)> isInventory = defaultIsInventory;
 
-    std::vector<entt::entity> defaultGetInventory(entt::entity ent) {
+    EntityView defaultViewInventory(entt::entity ent) {
         // A default inventory is the contents of the object where the object is not equipped, and has no
-        // RoomLocation, GridLocation, or SectorLocation.
-        auto contents = getContents(ent);
-        if(contents.empty()) return {};
+        // RoomLocation, GridLocation, or SectorLocation. The filter is the hook itself, so replacing
+        // isInventory changes it.
+        if(!gameIsLoading) ensureHydrated(ent);
+        if(!registry.valid(ent)) return {};
+        if(auto rev = registry.try_get<Contents>(ent)) return EntityView(rev->data, &isInventory);
+        return {};
+    }
+    std::function<EntityView(entt::entity)> viewInventory = defaultViewInventory;
 
-        // Filter contents by isInventory.
-        std::vector<entt::entity> inventory;
-        std::copy_if(contents.begin(), contents.end(), std::back_inserter(inventory), isInventory);
-        return inventory;
+    // It's up to an individual game to determine what counts as equipment, how equipment slots work, etc,
+    // but this function should still return a view of equipment entities.
+    EntityView defaultViewEquipment(entt::entity ent) {
+        // There may be better logic in the future, but for default we can do the opposite of defaultViewInventory, kinda.
+        if(!gameIsLoading) ensureHydrated(ent);
+        if(!registry.valid(ent)) return {};
+        if(auto rev = registry.try_get<Contents>(ent)) return EntityView(rev->data, &isEquipped);
+        return {};
+    }
+    std::function<EntityView(entt::entity)> viewEquipment = defaultViewEquipment;
+
+    std::vector<entt::entity> defaultGetInventory(entt::entity ent) {
+        return viewInventory(ent).toVector();
     }
     std::function<std::vector<entt::entity>(entt::entity)> getInventory = defaultGetInventory;
 
-    // It's up to an individual game to determine what counts as equipment, how equipment slots work, etc,
-    // but this function should still return a vector of equipment entities.
     std::vector<entt::entity> defaultGetEquipment(entt::entity ent) {
-        // There may be better logic in the future, but for default we can do the opposite of defaultGetInventory, kinda.
-        auto contents = getContents(ent);
-        if(contents.empty()) return {};
-
-        std::vector<entt::entity> equipped;
-        std::copy_if(contents.begin(), contents.end(), std::back_inserter(equipped), isEquipped);
-        return equipped;
+        return viewEquipment(ent).toVector();
     }
     std::function<std::vector<entt::entity>(entt::entity)> getEquipment = defaultGetEquipment;
 
@@ -484,10 +696,15 @@ namespace core {
     }
     std::function<std::optional<Destination>(entt::entity, const std::string&)> validDestination = defaultValidDestination;
 
-    std::vector<entt::entity> defaultGetRoomContents(entt::entity ent) {
+    EntityView defaultViewRoomContents(entt::entity ent) {
         auto rcon = registry.try_get<RoomContents>(ent);
         if(!rcon) return {};
-        return rcon->data;
+        return EntityView(rcon->data);
+    }
+    std::function<EntityView(entt::entity)> viewRoomContents = defaultViewRoomContents;
+
+    std::vector<entt::entity> defaultGetRoomContents(entt::entity ent) {
+        return viewRoomContents(ent).toVector();
     }
     std::function<std::vector<entt::entity>(entt::entity)> getRoomContents = defaultGetRoomContents;
 
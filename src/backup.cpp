@@ -0,0 +1,124 @@
+#include "core/backup.h"
+#include "core/config.h"
+#include "core/journal.h"
+#include <filesystem>
+
+namespace core {
+
+    static std::mutex backupMutex;
+    static BackupStatus backupStatus;
+
+    BackupStatus getBackupStatus() {
+        std::lock_guard<std::mutex> lock(backupMutex);
+        return backupStatus;
+    }
+
+    std::string makeBackupPath() {
+        return fmt::format(fmt::runtime(config::dbBackupName), getUnixTimestamp());
+    }
+
+    // Everything one backup needs between steps. Owned by the jobs, which pass it along.
+    struct BackupJob {
+        std::string path, tempPath;
+        std::unique_ptr<SQLite::Database> dest;
+        std::unique_ptr<SQLite::Backup> backup;
+    };
+
+    static void finishBackup(BackupJob& job, std::optional<std::string> error) {
+        job.backup.reset();
+        job.dest.reset();
+        if(!error) {
+            std::error_code ec;
+            std::filesystem::rename(job.tempPath, job.path, ec);
+            if(ec) error = fmt::format("Could not rename {} to {}: {}", job.tempPath, job.path, ec.message());
+        }
+        if(error) {
+            std::error_code ec;
+            std::filesystem::remove(job.tempPath, ec);
+        }
+
+        std::lock_guard<std::mutex> lock(backupMutex);
+        backupStatus.running = false;
+        backupStatus.finished = std::chrono::system_clock::now();
+        backupStatus.error = error;
+        auto seconds = std::chrono::duration<double>(backupStatus.finished - backupStatus.started).count();
+        if(error) logger->error("Backup to {} failed: {}", job.path, *error);
+        else logger->info("Backed up {} pages to {} in {} steps over {:.3f} seconds.",
+                          backupStatus.totalPages, job.path, backupStatus.steps, seconds);
+    }
+
+    // Copies up to config::dbBackupPagesPerStep pages. Returns true once the backup is finished,
+    // whether or not it succeeded.
+    static bool stepBackup(BackupJob& job, SQLite::Database& conn) {
+        try {
+            if(!job.backup) {
+                job.dest = std::make_unique<SQLite::Database>(job.tempPath, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+                job.backup = std::make_unique<SQLite::Backup>(*job.dest, conn);
+            }
+            auto pages = config::dbBackupPagesPerStep > 0 ? config::dbBackupPagesPerStep : -1;
+            auto rc = job.backup->executeStep(pages);
+            {
+                std::lock_guard<std::mutex> lock(backupMutex);
+                backupStatus.totalPages = job.backup->getTotalPageCount();
+                backupStatus.remainingPages = job.backup->getRemainingPageCount();
+                backupStatus.steps++;
+            }
+            if(rc != SQLITE_DONE) return false;
+        } catch(std::exception& e) {
+            finishBackup(job, e.what());
+            return true;
+        }
+        finishBackup(job, std::nullopt);
+        return true;
+    }
+
+    // Runs one step, then goes to the back of the writer's queue for the next.
+    static void runBackupJob(std::shared_ptr<BackupJob> job, SQLite::Database& conn) {
+        if(stepBackup(*job, conn)) return;
+        dbWriter->submit([job](SQLite::Database& c) { runBackupJob(job, c); });
+    }
+
+    OpResult<> startBackup(const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(backupMutex);
+            if(backupStatus.running) return {false, fmt::format("A backup to {} is already running.", backupStatus.path)};
+            backupStatus = BackupStatus{};
+            backupStatus.running = true;
+            backupStatus.path = path;
+            backupStatus.started = std::chrono::system_clock::now();
+        }
+
+        auto job = std::make_shared<BackupJob>();
+        job->path = path;
+        job->tempPath = path + ".tmp";
+        if(auto parent = std::filesystem::path(path).parent_path(); !parent.empty()) {
+            std::error_code ec;
+            std::filesystem::create_directories(parent, ec);
+        }
+
+        // The backup should have everything saved up to now, including what's only journaled.
+        processDirty();
+        if(!dbWriter || !dbWriter->isRunning()) {
+            while(!stepBackup(*job, *db)) {}
+            auto status = getBackupStatus();
+            if(status.error) return {false, status.error};
+            return {true, std::nullopt};
+        }
+        if(journal) dbWriter->submit(compactJournal);
+        dbWriter->submit([job](SQLite::Database& conn) { runBackupJob(job, conn); });
+        return {true, std::nullopt};
+    }
+
+    OpResult<> verifyBackup(const std::string& path) {
+        try {
+            SQLite::Database backup(path, SQLite::OPEN_READONLY);
+            auto result = backup.execAndGet("PRAGMA integrity_check;").getString();
+            if(result != "ok") return {false, fmt::format("Integrity check failed: {}", result)};
+            if(!backup.tableExists("objects")) return {false, "It has no objects table."};
+        } catch(std::exception& e) {
+            return {false, e.what()};
+        }
+        return {true, std::nullopt};
+    }
+
+}
@@ -5,6 +5,9 @@ namespace core {
     std::unique_ptr<boost::asio::io_context> executor;
     std::shared_ptr<spdlog::logger> logger;
 
+    // Before the registry, so that it outlives every StringView in it.
+    InternTable stringPool;
+
     entt::registry registry;
 
     bool gameIsLoading{true};
@@ -12,13 +15,27 @@ namespace core {
     entt::entity createObject() {
         auto id = createObjectId();
         auto obj = registry.create();
-        if(id.index >= objects.size())
-            objects.resize(id.index + 40);
         objects[id.index] = std::make_pair(id.generation, obj);
         registry.emplace<ObjectId>(obj, id);
         return obj;
     }
 
+    std::vector<entt::entity> createObjects(std::size_t count) {
+        std::vector<entt::entity> ents(count);
+        registry.create(ents.begin(), ents.end());
+        std::vector<ObjectId> ids;
+        ids.reserve(count);
+        for(auto ent : ents) {
+            // Each slot is taken as soon as it's found, so that the next lookup can't return it.
+            auto index = getFreeObjectId();
+            auto generation = nextObjectGeneration(index);
+            objects[index] = std::make_pair(generation, ent);
+            ids.emplace_back(index, generation);
+        }
+        registry.insert<ObjectId>(ents.begin(), ents.end(), ids.begin());
+        return ents;
+    }
+
     void setDirty(entt::entity ent, bool override) {
         if(!registry.valid(ent)) return;
         auto objid = registry.try_get<ObjectId>(ent);
@@ -33,6 +50,16 @@ namespace core {
         dirty.insert(id);
     }
 
+    void setComponentsDirty(const ObjectId& id, uint64_t mask, bool override) {
+        if(gameIsLoading && !override) return;
+        // A mask of 0 means we couldn't narrow it down.
+        if(!mask) {
+            dirty.insert(id);
+            return;
+        }
+        dirtyComponents.insert(id, mask);
+    }
+
     std::string ObjectId::toString() const {
         return fmt::format("#{}:{}", index, generation);
     }
@@ -45,6 +72,9 @@ namespace core {
         if (obj.first != generation) {
             return entt::null;
         }
+        if (obj.second == entt::null && isObjectCold(index) && warmObject(index)) {
+            return objects[index].second;
+        }
         return obj.second;
     }
 
@@ -53,6 +83,9 @@ namespace core {
             return entt::null;
         }
         auto& obj = objects[index];
+        if (obj.second == entt::null && isObjectCold(index) && warmObject(index)) {
+            return objects[index].second;
+        }
         if (!registry.valid(obj.second)) {
             return entt::null;
         }
@@ -65,16 +98,59 @@ namespace core {
 
     std::vector<std::pair<int64_t, entt::entity>> objects;
 
+    std::unordered_map<std::size_t, ObjectId> coldObjects;
+
+    bool isObjectCold(std::size_t index) {
+        return coldObjects.contains(index);
+    }
+
+    // Slots which were free when they were put here, most recently freed last. Loaders write
+    // to objects directly, so each is checked again when it's taken.
+    static std::vector<std::size_t> freeObjectIds;
+    // Every slot below this has been looked at. Any of them that's freed later goes on the free list.
+    static std::size_t freeObjectCursor{0};
+
+    static bool isObjectSlotFree(std::size_t index) {
+        return index < objects.size() && !registry.valid(objects[index].second) && !isObjectCold(index);
+    }
+
     std::size_t getFreeObjectId() {
-        std::size_t i = 0;
-        for (; i < objects.size(); i++) {
-            if (!registry.valid(objects[i].second)) {
-                return i;
-            }
+        while(!freeObjectIds.empty()) {
+            auto index = freeObjectIds.back();
+            freeObjectIds.pop_back();
+            if(isObjectSlotFree(index)) return index;
         }
-        // We couldn't find any, so let's resize the vector to hold some more...
-        objects.resize(i + 40, {0, entt::null});
-        return i;
+        freeObjectCursor = std::min(freeObjectCursor, objects.size());
+        while(freeObjectCursor < objects.size()) {
+            auto index = freeObjectCursor++;
+            if(isObjectSlotFree(index)) return index;
+        }
+        objects.emplace_back(0, entt::null);
+        freeObjectCursor = objects.size();
+        return objects.size() - 1;
+    }
+
+    void onObjectIdDestroyed(entt::registry& reg, entt::entity ent) {
+        auto index = reg.get<ObjectId>(ent).index;
+        // An evicted object is marked cold before it's destroyed; its slot isn't free.
+        if(index < freeObjectCursor && !isObjectCold(index)) freeObjectIds.push_back(index);
+    }
+
+    void resetFreeObjectIds() {
+        freeObjectIds.clear();
+        freeObjectCursor = 0;
+    }
+
+    int64_t lastObjectGeneration{0};
+
+    int64_t nextObjectGeneration(std::size_t index) {
+        auto previous = index < objects.size() ? objects[index].first : 0;
+        lastObjectGeneration = std::max({lastObjectGeneration + 1, previous + 1, getUnixTimestamp()});
+        return lastObjectGeneration;
+    }
+
+    void noteObjectGeneration(int64_t gen) {
+        lastObjectGeneration = std::max(lastObjectGeneration, gen);
     }
 
 
@@ -85,7 +161,8 @@ namespace core {
     }
 
     ObjectId createObjectId() {
-        return {getFreeObjectId(), getUnixTimestamp()};
+        auto index = getFreeObjectId();
+        return {index, nextObjectGeneration(index)};
     }
 
     // the obj_regex is supposed to watch for patterns like #5 or #8721:1680642313 and capture the numbers.
@@ -120,21 +197,279 @@ namespace core {
 
 
 
-    std::unordered_set<std::string> stringPool;
+    InternTable::Header* InternTable::headerOf(std::string_view str) {
+        return reinterpret_cast<Header*>(const_cast<char*>(str.data()) - sizeof(Header));
+    }
+
+    char* InternTable::allocate(std::size_t size, uint32_t& sizeClass) {
+        sizeClass = 0;
+        std::size_t slot = minSlot;
+        while(slot < size && sizeClass < largeClass) {
+            slot <<= 1;
+            sizeClass++;
+        }
+        // Anything which won't fit a block's slot gets an allocation of its own.
+        if(slot < size || slot > blockSize || sizeClass >= largeClass) {
+            sizeClass = largeClass;
+            auto mem = std::make_unique<char[]>(size);
+            auto ptr = mem.get();
+            large.emplace(reinterpret_cast<const Header*>(ptr), std::move(mem));
+            counters.arenaBytes += size;
+            return ptr;
+        }
+        if(auto &slots = freeSlots[sizeClass]; !slots.empty()) {
+            auto ptr = slots.back();
+            slots.pop_back();
+            counters.freeBytes -= slot;
+            return ptr;
+        }
+        if(blockUsed + slot > blockSize) {
+            blocks.push_back(std::make_unique<char[]>(blockSize));
+            counters.arenaBytes += blockSize;
+            blockUsed = 0;
+        }
+        auto ptr = blocks.back().get() + blockUsed;
+        blockUsed += slot;
+        return ptr;
+    }
+
+    std::string_view InternTable::acquire(std::string_view str) {
+        if(str.empty()) return {};
+        counters.lookups++;
+        if(auto found = strings.find(str); found != strings.end()) {
+            counters.hits++;
+            found->second->refs++;
+            return found->first;
+        }
+        uint32_t sizeClass;
+        auto mem = allocate(sizeof(Header) + str.size(), sizeClass);
+        auto header = reinterpret_cast<Header*>(mem);
+        header->refs = 1;
+        header->sizeClass = sizeClass;
+        auto text = mem + sizeof(Header);
+        std::memcpy(text, str.data(), str.size());
+        std::string_view view(text, str.size());
+        strings.emplace(view, header);
+        counters.unique++;
+        counters.bytes += str.size();
+        return view;
+    }
+
+    void InternTable::retain(std::string_view str) {
+        if(str.empty()) return;
+        headerOf(str)->refs++;
+    }
+
+    void InternTable::release(std::string_view str) {
+        if(str.empty()) return;
+        auto header = headerOf(str);
+        if(--header->refs) return;
+        strings.erase(str);
+        counters.unique--;
+        counters.bytes -= str.size();
+        if(header->sizeClass == largeClass) {
+            counters.arenaBytes -= sizeof(Header) + str.size();
+            large.erase(header);
+            return;
+        }
+        freeSlots[header->sizeClass].push_back(reinterpret_cast<char*>(header));
+        counters.freeBytes += minSlot << header->sizeClass;
+    }
+
+    InternStats InternTable::stats() const {
+        return counters;
+    }
 
     std::string_view intern(const std::string& str) {
-        auto pair = stringPool.insert(str);
-        return std::string_view(*pair.first);
+        return stringPool.acquire(str);
     }
 
     std::string_view intern(std::string_view str) {
-        return intern(std::string(str));
+        return stringPool.acquire(str);
+    }
+
+    void parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)>& func, int threads) {
+        if(!count) return;
+        std::size_t workers = threads < 1 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+        workers = std::min(workers, count);
+        if(workers == 1) {
+            func(0, count);
+            return;
+        }
+
+        // Hand out small ranges from a shared counter so that uneven rows balance out.
+        std::size_t grain = std::max<std::size_t>(1, count / (workers * 8));
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        auto work = [&]() {
+            while(true) {
+                auto begin = next.fetch_add(grain);
+                if(begin >= count) return;
+                try {
+                    func(begin, std::min(begin + grain, count));
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if(!error) error = std::current_exception();
+                    next = count;
+                    return;
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for(std::size_t i = 1; i < workers; i++) pool.emplace_back(work);
+        work();
+        for(auto &t : pool) t.join();
+        if(error) std::rethrow_exception(error);
+    }
+
+    uint64_t checksum64(const void* data, std::size_t size) {
+        auto bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = 14695981039346656037ULL;
+        for(std::size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
     }
 
     std::random_device randomDevice;
     std::default_random_engine randomEngine(randomDevice());
 
-    std::unordered_set<ObjectId> dirty;
+    DirtySet dirty;
+    DirtySet dirtyComponents;
+
+    bool DirtySet::isMarked(std::size_t index) const {
+        auto word = index / 64;
+        return word < words.size() && (words[word] >> (index % 64)) & 1;
+    }
+
+    bool DirtySet::insert(const ObjectId& id, uint64_t mask) {
+        auto word = id.index / 64;
+        if(word >= words.size()) {
+            // Grown in step with the arena, so that this is rare.
+            auto size = std::max(word + 1, objects.size() / 64 + 1);
+            words.resize(size, 0);
+            slots.resize(size * 64);
+        }
+        // Usually empty; see below.
+        for(auto &entry : setAside) {
+            if(entry.id == id) {
+                entry.mask |= mask;
+                return false;
+            }
+        }
+        auto &slot = slots[id.index];
+        if(!isMarked(id.index)) {
+            words[word] |= uint64_t(1) << (id.index % 64);
+            slot = {id.generation, mask};
+            count++;
+            return true;
+        }
+        if(slot.generation == id.generation) {
+            slot.mask |= mask;
+            return false;
+        }
+        // The slot was reused while its last occupant was still marked.
+        setAside.push_back({ObjectId(id.index, slot.generation), slot.mask});
+        slot = {id.generation, mask};
+        count++;
+        return true;
+    }
+
+    bool DirtySet::contains(const ObjectId& id) const {
+        if(isMarked(id.index) && slots[id.index].generation == id.generation) return true;
+        for(auto &entry : setAside) {
+            if(entry.id == id) return true;
+        }
+        return false;
+    }
+
+    uint64_t DirtySet::mask(const ObjectId& id) const {
+        if(isMarked(id.index) && slots[id.index].generation == id.generation) return slots[id.index].mask;
+        for(auto &entry : setAside) {
+            if(entry.id == id) return entry.mask;
+        }
+        return 0;
+    }
+
+    bool DirtySet::erase(const ObjectId& id) {
+        if(isMarked(id.index) && slots[id.index].generation == id.generation) {
+            words[id.index / 64] &= ~(uint64_t(1) << (id.index % 64));
+            count--;
+            return true;
+        }
+        for(auto it = setAside.begin(); it != setAside.end(); ++it) {
+            if(it->id == id) {
+                setAside.erase(it);
+                count--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void DirtySet::clear() {
+        if(!count) return;
+        std::fill(words.begin(), words.end(), 0);
+        setAside.clear();
+        count = 0;
+    }
+
+    DirtySet::const_iterator DirtySet::begin() const {
+        return {this, 0};
+    }
+
+    DirtySet::const_iterator DirtySet::end() const {
+        return {this, setAside.size() + words.size() * 64};
+    }
+
+    DirtySet::const_iterator::const_iterator(const DirtySet* set, std::size_t pos) : set(set), pos(pos) {
+        settle();
+    }
+
+    void DirtySet::const_iterator::settle() {
+        auto asideCount = set->setAside.size();
+        if(pos < asideCount) return;
+        auto bit = pos - asideCount;
+        auto word = bit / 64;
+        auto wordCount = set->words.size();
+        if(word >= wordCount) {
+            pos = asideCount + wordCount * 64;
+            return;
+        }
+        // Bits below the current position in its word have already been visited.
+        auto bits = set->words[word] & (~uint64_t(0) << (bit % 64));
+        while(!bits) {
+            if(++word >= wordCount) {
+                pos = asideCount + wordCount * 64;
+                return;
+            }
+            bits = set->words[word];
+        }
+        pos = asideCount + word * 64 + std::countr_zero(bits);
+    }
+
+    ObjectId DirtySet::const_iterator::operator*() const {
+        auto asideCount = set->setAside.size();
+        if(pos < asideCount) return set->setAside[pos].id;
+        auto index = pos - asideCount;
+        return {index, set->slots[index].generation};
+    }
+
+    DirtySet::const_iterator& DirtySet::const_iterator::operator++() {
+        pos++;
+        settle();
+        return *this;
+    }
+
+    DirtySet::const_iterator DirtySet::const_iterator::operator++(int) {
+        auto old = *this;
+        ++*this;
+        return old;
+    }
     std::unordered_map<RoomId, entt::entity> legacyRooms;
     std::unordered_map<RoomId, GridPoint> legacySpaceRooms;
 
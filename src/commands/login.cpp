@@ -3,7 +3,9 @@
 #include "core/api.h"
 #include "core/connection.h"
 #include "core/session.h"
-#include "core/database.h"
+#include "core/accounts.h"
+#include "core/backup.h"
+#include "core/ndjson.h"
 
 namespace core::cmd {
 
@@ -12,14 +14,12 @@ namespace core::cmd {
 
 
         std::vector<entt::entity> characters;
-        SQLite::Statement q1(*db, "SELECT character FROM playerCharacters WHERE account = ?;");
-        q1.bind(1, acc);
-
-        while(q1.executeStep()) {
-            auto character = q1.getColumn(0).getInt64();
-            auto found = getObject(character);
-            if(registry.valid(found)) {
-                characters.push_back(found);
+        if(auto record = getAccountRecord(acc)) {
+            for(auto character : record->characters) {
+                auto found = getObject(character);
+                if(registry.valid(found)) {
+                    characters.push_back(found);
+                }
             }
         }
 
@@ -46,9 +46,109 @@ namespace core::cmd {
 
     }
 
+    bool LoginCommandBackup::isAvailable(const std::shared_ptr<Connection>& connection) {
+        return connection->getAdminLevel() > 0;
+    }
+
+    void LoginCommandBackup::execute(const std::shared_ptr<Connection>& connection, std::unordered_map<std::string, std::string>& input) {
+        auto status = getBackupStatus();
+        if(input["args"] == "status") {
+            if(status.running) {
+                connection->sendText(fmt::format("Backing up to {}: {} of {} pages left.\n", status.path,
+                                                 status.remainingPages, status.totalPages));
+            } else if(!status.path.empty()) {
+                connection->sendText(fmt::format("The last backup, to {}, {}.\n", status.path,
+                                                 status.error ? "failed: " + *status.error : "succeeded"));
+            } else {
+                connection->sendText("No backups have been made since startup.\n");
+            }
+            return;
+        }
+
+        auto path = makeBackupPath();
+        auto [res, err] = startBackup(path);
+        if(!res) {
+            connection->sendText(fmt::format("Could not start a backup: {}\n", err.value_or("unknown reason")));
+            return;
+        }
+        connection->sendText(fmt::format("Backing up to {}. Use 'backup status' to check on it.\n", path));
+    }
+
+    bool LoginCommandExport::isAvailable(const std::shared_ptr<Connection>& connection) {
+        return connection->getAdminLevel() > 0;
+    }
+
+    void LoginCommandExport::execute(const std::shared_ptr<Connection>& connection, std::unordered_map<std::string, std::string>& input) {
+        std::vector<std::string> args;
+        boost::split(args, input["args"], boost::is_space(), boost::token_compress_on);
+        if(args.empty() || args[0].empty()) {
+            connection->sendText("Usage: export <file> [<#zone>]\n");
+            return;
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        OpResult<std::size_t> result;
+        if(args.size() > 1) {
+            auto zone = parseObjectId(args[1]);
+            if(!registry.valid(zone)) {
+                connection->sendText("No such object.\n");
+                return;
+            }
+            result = exportZone(args[0], zone);
+        } else {
+            result = exportWorld(args[0]);
+        }
+        auto &[count, err] = result;
+        if(err) {
+            connection->sendText(fmt::format("Export failed: {}\n", *err));
+            return;
+        }
+        connection->sendText(fmt::format("Exported {} objects to {} in {:.3f} seconds.\n", count, args[0],
+                                         std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count()));
+    }
+
+    bool LoginCommandImport::isAvailable(const std::shared_ptr<Connection>& connection) {
+        return connection->getAdminLevel() > 0;
+    }
+
+    void LoginCommandImport::execute(const std::shared_ptr<Connection>& connection, std::unordered_map<std::string, std::string>& input) {
+        std::vector<std::string> args;
+        boost::split(args, input["args"], boost::is_space(), boost::token_compress_on);
+        if(args.empty() || args[0].empty()) {
+            connection->sendText("Usage: import <file> [keep]\n");
+            return;
+        }
+        bool keepIds = args.size() > 1 && boost::iequals(args[1], "keep");
+
+        auto started = std::chrono::steady_clock::now();
+        auto [count, err] = importObjects(args[0], !keepIds);
+        if(err) {
+            connection->sendText(fmt::format("Import failed: {}\n", *err));
+            if(!count) return;
+        }
+        connection->sendText(fmt::format("Imported {} objects from {} in {:.3f} seconds.\n", count, args[0],
+                                         std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count()));
+    }
+
+    bool LoginCommandStrings::isAvailable(const std::shared_ptr<Connection>& connection) {
+        return connection->getAdminLevel() > 0;
+    }
+
+    void LoginCommandStrings::execute(const std::shared_ptr<Connection>& connection, std::unordered_map<std::string, std::string>& input) {
+        auto stats = stringPool.stats();
+        double hitRate = stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0;
+        connection->sendText(fmt::format("Strings: {} unique, {} bytes of text.\n", stats.unique, stats.bytes));
+        connection->sendText(fmt::format("Arena: {} bytes reserved, {} bytes free for reuse.\n", stats.arenaBytes, stats.freeBytes));
+        connection->sendText(fmt::format("Lookups: {}, {:.1f}% found an existing string.\n", stats.lookups, hitRate));
+    }
+
     void registerLoginCommands() {
         registerLoginCommand(std::make_shared<LoginCommandPlay>());
         registerLoginCommand(std::make_shared<LoginCommandNew>());
+        registerLoginCommand(std::make_shared<LoginCommandBackup>());
+        registerLoginCommand(std::make_shared<LoginCommandExport>());
+        registerLoginCommand(std::make_shared<LoginCommandImport>());
+        registerLoginCommand(std::make_shared<LoginCommandStrings>());
     }
 
 }
\ No newline at end of file
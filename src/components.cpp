@@ -4,9 +4,51 @@
 
 namespace core {
 
+    StringView::StringView(const StringView& other) : data(other.data), clean(other.clean) {
+        stringPool.retain(data);
+        stringPool.retain(clean);
+    }
+
+    StringView::StringView(StringView&& other) noexcept : data(other.data), clean(other.clean) {
+        other.data = {};
+        other.clean = {};
+    }
+
+    StringView& StringView::operator=(const StringView& other) {
+        if(this == &other) return *this;
+        stringPool.retain(other.data);
+        stringPool.retain(other.clean);
+        stringPool.release(data);
+        stringPool.release(clean);
+        data = other.data;
+        clean = other.clean;
+        return *this;
+    }
+
+    StringView& StringView::operator=(StringView&& other) noexcept {
+        if(this == &other) return *this;
+        stringPool.release(data);
+        stringPool.release(clean);
+        data = other.data;
+        clean = other.clean;
+        other.data = {};
+        other.clean = {};
+        return *this;
+    }
+
+    StringView::~StringView() {
+        stringPool.release(data);
+        stringPool.release(clean);
+    }
+
     void StringView::setData(const std::string& txt) {
-        data = intern(txt);
-        clean = intern(stripAnsi(txt));
+        // Acquired before the old text is released, in case it's the same.
+        auto newData = stringPool.acquire(txt);
+        auto newClean = stringPool.acquire(stripAnsi(txt));
+        stringPool.release(data);
+        stringPool.release(clean);
+        data = newData;
+        clean = newClean;
     }
 
     nlohmann::json Destination::serialize() {
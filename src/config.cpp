@@ -9,4 +9,27 @@ namespace core::config {
     uint16_t thermitePort{7000};
     boost::asio::ip::tcp::endpoint thermiteEndpoint;
     std::string dbName = "coremud.sqlite3";
+    std::string dbJournalMode = "WAL";
+    std::string dbSynchronous = "NORMAL";
+    int64_t dbCacheSize{-65536};
+    int64_t dbMmapSize{268435456};
+    std::size_t dbSaveChunkSize{1000};
+    bool dbBinaryObjects{true};
+    int dbLoadThreads{0};
+    std::string dbSnapshotName = "coremud.snapshot";
+    std::string dbJournalName = "coremud.journal";
+    uint64_t dbJournalCompactBytes{64 * 1024 * 1024};
+    std::chrono::seconds dbJournalCompactInterval{300};
+    bool checkpointIncremental{true};
+    std::chrono::microseconds checkpointTimeBudget{2000};
+    std::size_t checkpointByteBudget{1024 * 1024};
+    std::size_t checkpointEpochTicks{0};
+    bool dbLazyZones{false};
+    std::chrono::seconds zoneIdleTimeout{0};
+    std::chrono::seconds zoneCheckInterval{5};
+    std::chrono::seconds accountFlushInterval{10};
+    std::string dbBackupName = "backups/coremud-{}.sqlite3";
+    int dbBackupPagesPerStep{256};
+    std::chrono::seconds dbBackupInterval{0};
+    std::size_t dbTransferChunkSize{4096};
 }
\ No newline at end of file
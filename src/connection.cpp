@@ -3,8 +3,10 @@
 #include "core/commands.h"
 #include "core/session.h"
 #include "core/database.h"
+#include "core/accounts.h"
 #include "core/api.h"
 #include "core/components.h"
+#include <future>
 
 namespace core {
 
@@ -89,6 +91,9 @@ namespace core {
     }
 
     void Connection::onNetworkDisconnected() {
+        if(account != -1) {
+            recordAccountLogout(account, std::chrono::duration<double>(std::chrono::steady_clock::now() - loggedIn).count());
+        }
         if(session) {
             session->removeConnection(connId);
         }
@@ -249,16 +254,13 @@ namespace core {
     }
 
     void Connection::onLogin() {
-        SQLite::Statement q(*db, "UPDATE accounts SET lastLogin = datetime('now') WHERE id = ?");
-        q.bind(1, account);
-        q.exec();
+        loggedIn = std::chrono::steady_clock::now();
+        recordAccountLogin(account);
 
-        SQLite::Statement q2(*db, "SELECT username,adminLevel FROM accounts WHERE id = ?");
-        q2.bind(1, account);
         std::string name;
-        while(q2.executeStep()) {
-            name = q2.getColumn(0).getString();
-            adminLevel = q2.getColumn(1).getInt();
+        if(auto record = getAccountRecord(account)) {
+            name = record->username;
+            adminLevel = record->adminLevel;
         }
 
         sendText(fmt::format("Welcome back, {}!\r\n", name));
@@ -270,15 +272,11 @@ namespace core {
     }
 
     void Connection::displayAccountMenu() {
-        std::string username, email;
-        int level;
-        SQLite::Statement q(*db, "SELECT username, email, adminLevel FROM accounts WHERE id = ?");
-        q.bind(1, account);
-        while(q.executeStep()) {
-            username = q.getColumn(0).getString();
-            email = q.getColumn(1).getString();
-            level = q.getColumn(2).getInt();
-        }
+        auto record = getAccountRecord(account);
+        if(!record) return;
+        auto &username = record->username;
+        auto &email = record->email;
+        auto level = record->adminLevel;
         sendText("                 @RAccount Menu@n\n");
         sendText("=============================================\n");
         sendText(fmt::format("|@g{:<14}@n:  {:<27}|\n", "Username", username));
@@ -289,14 +287,8 @@ namespace core {
         sendText("=============================================\n\n");
 
         std::vector<ObjectId> characters;
-        SQLite::Statement q2(*db, "SELECT character,lastLogin,lastLogout,totalPlayTime FROM playerCharacters WHERE account = ?");
-        q2.bind(1, account);
-        while(q2.executeStep()) {
-            auto character = q2.getColumn(0).getInt64();
-            auto lastLogin = q2.getColumn(1).getString();
-            auto lastLogout = q2.getColumn(2).getString();
-            auto totalPlayTime = q2.getColumn(3).getString();
-
+        for(auto character : record->characters) {
+            if(character < 0 || static_cast<std::size_t>(character) >= objects.size()) continue;
             characters.emplace_back(character, objects[character].first);
         }
 
@@ -319,19 +311,14 @@ namespace core {
     }
 
     OpResult<> Connection::handleLogin(const std::string &userName, const std::string &password) {
-        SQLite::Statement q(*db, "SELECT id,password FROM accounts WHERE username = ?");
-        q.bind(1, userName);
-        while(q.executeStep()) {
-            auto id = q.getColumn(0).getInt64();
-            auto pass = q.getColumn(1).getString();
-            auto [check, err] = core::checkPassword(pass, password);
-            if(!check) {
-                return {false, err};
-            }
-            loginToAccount(id);
-            return {true, std::nullopt};
+        auto record = findAccountByName(userName);
+        if(!record) return {false, "No such account.\n"};
+        auto [check, err] = core::checkPassword(record->password, password);
+        if(!check) {
+            return {false, err};
         }
-        return {false, "No such account.\n"};
+        loginToAccount(record->id);
+        return {true, std::nullopt};
     }
 
     void Connection::createOrJoinSession(entt::entity ent) {
@@ -378,14 +365,53 @@ namespace core {
     OpResult<int64_t> createAccount(std::string_view username, std::string_view password) {
         auto [res, err] = validateAccountUsername(username, -1);
         if (!res) return {-1, err};
+        if (findAccountByName(username)) return {-1, "That username is already taken."};
         auto [res2, err2] = hashPassword(password);
         if (!res2) return {-1, err2};
 
-        SQLite::Statement q(*db, "INSERT INTO accounts (username, password) VALUES (?, ?)");
-        q.bind(1, std::string(username));
-        q.bind(2, err2.value());
-        q.exec();
-        auto id = db->getLastInsertRowid();
+        // The times are given rather than left to the column defaults, so that the record and the
+        // row agree to the second.
+        int64_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        auto insert = [&](SQLite::Database& conn) {
+            auto q = prepare(conn, "INSERT INTO accounts (username, password, created, lastLogin, lastLogout, lastPasswordChanged) VALUES (?, ?, ?, ?, ?, ?)");
+            q->bind(1, std::string(username));
+            q->bind(2, err2.value());
+            for(int i = 3; i <= 6; i++) q->bind(i, now);
+            q->exec();
+            return conn.getLastInsertRowid();
+        };
+
+        int64_t id = -1;
+        try {
+            if(dbWriter && dbWriter->isRunning()) {
+                // On the writer's own connection, so that it can't find the database locked by a
+                // save in progress. The id is needed now, so this waits for it to be written.
+                std::promise<int64_t> inserted;
+                auto result = inserted.get_future();
+                dbWriter->submit([&](SQLite::Database& conn) {
+                    try {
+                        inserted.set_value(insert(conn));
+                    } catch(...) {
+                        inserted.set_exception(std::current_exception());
+                    }
+                });
+                id = result.get();
+            } else {
+                id = insert(*db);
+            }
+        } catch(std::exception& e) {
+            logger->error("Could not create account {}: {}", username, e.what());
+            return {-1, "The account could not be created. Please try again later."};
+        }
+
+        AccountRecord record;
+        record.id = id;
+        record.username = username;
+        record.password = err2.value();
+        record.created = now;
+        record.lastLogin = record.created;
+        record.lastLogout = record.created;
+        indexAccount(std::move(record));
         return {id, std::nullopt};
     }
 }
\ No newline at end of file
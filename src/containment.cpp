@@ -0,0 +1,184 @@
+#include "core/containment.h"
+#include "core/components.h"
+#include "core/api.h"
+
+namespace core {
+
+    bool deferContainment{false};
+
+    // A root's interval. Plenty for any tree which fits in memory.
+    static constexpr uint64_t rootSpan = uint64_t(1) << 62;
+
+    // What an arrival takes from its new container's gap: its two labels per entity, with room for
+    // its subtree to grow to four times its size before it needs more.
+    static constexpr uint64_t reservePerEntity = 8;
+
+    // Counts ent and everything inside of it, remembering the count for each of them in sizes.
+    // Reads Contents directly, so that nothing cold is hydrated.
+    static std::size_t subtreeSize(entt::entity ent, std::unordered_map<entt::entity, std::size_t>& sizes) {
+        std::size_t size = 1;
+        if(auto con = registry.try_get<Contents>(ent)) {
+            for(auto child : con->data) {
+                if(registry.valid(child)) size += subtreeSize(child, sizes);
+            }
+        }
+        sizes[ent] = size;
+        return size;
+    }
+
+    // Labels ent's subtree within [lo, hi], which must hold at least two labels for each entity in
+    // it. Half of whatever is left over goes to ent's children in proportion to their size; the
+    // other half is kept at the end of ent's interval for what's put in it later.
+    static void layout(entt::entity ent, uint64_t lo, uint64_t hi, uint32_t depth, entt::entity root,
+                       const std::unordered_map<entt::entity, std::size_t>& sizes) {
+        auto &self = registry.get_or_emplace<Containment>(ent);
+        self.root = root;
+        self.depth = depth;
+        self.enter = lo;
+        self.exit = hi;
+        self.nextFree = lo + 1;
+
+        auto inside = sizes.at(ent) - 1;
+        if(!inside) return;
+        auto extra = (hi - lo - 1) - 2 * inside;
+        auto share = extra / 2 / inside;
+        auto cursor = lo + 1;
+        if(auto con = registry.try_get<Contents>(ent)) {
+            for(auto child : con->data) {
+                if(!registry.valid(child)) continue;
+                auto size = sizes.at(child);
+                auto width = 2 * size + share * size;
+                layout(child, cursor, cursor + width - 1, depth + 1, root, sizes);
+                cursor += width;
+            }
+        }
+        // Emplacing Containment on the children may have moved self.
+        registry.get<Containment>(ent).nextFree = cursor;
+    }
+
+    static void layoutRoot(entt::entity ent) {
+        std::unordered_map<entt::entity, std::size_t> sizes;
+        subtreeSize(ent, sizes);
+        layout(ent, 0, rootSpan - 1, 0, ent, sizes);
+    }
+
+    // Labels ent's subtree from the gap at the end of loc's interval, if there's room for it.
+    static bool placeInGap(entt::entity ent, entt::entity loc, const std::unordered_map<entt::entity, std::size_t>& sizes) {
+        uint64_t size = sizes.at(ent);
+        auto &parent = registry.get<Containment>(loc);
+        auto gap = parent.exit - parent.nextFree;
+        auto width = std::min(gap, reservePerEntity * size);
+        if(width < 2 * size) return false;
+        auto lo = parent.nextFree;
+        auto depth = parent.depth + 1;
+        auto root = parent.root;
+        parent.nextFree += width;
+        layout(ent, lo, lo + width - 1, depth, root, sizes);
+        return true;
+    }
+
+    // Lays out again the nearest container, starting at target, with room for twice its whole
+    // subtree. This is also what reclaims the intervals of whatever has left those containers.
+    static void relabelFrom(entt::entity target) {
+        std::unordered_map<entt::entity, std::size_t> sizes;
+        while(true) {
+            sizes.clear();
+            uint64_t total = subtreeSize(target, sizes);
+            auto &con = registry.get<Containment>(target);
+            auto above = getLocation(target);
+            if(!registry.valid(above)) {
+                layout(target, 0, rootSpan - 1, 0, target, sizes);
+                return;
+            }
+            if(con.exit - con.enter + 1 >= 4 * total) {
+                layout(target, con.enter, con.exit, con.depth, con.root, sizes);
+                return;
+            }
+            target = above;
+        }
+    }
+
+    void updateContainment(entt::entity ent) {
+        if(!registry.valid(ent)) return;
+        auto loc = getLocation(ent);
+        if(!registry.valid(loc)) {
+            layoutRoot(ent);
+            return;
+        }
+        // ent is already in loc's Contents, so labelling loc takes care of it too.
+        if(!registry.all_of<Containment>(loc)) {
+            updateContainment(loc);
+            return;
+        }
+
+        std::unordered_map<entt::entity, std::size_t> sizes;
+        subtreeSize(ent, sizes);
+        if(!placeInGap(ent, loc, sizes)) relabelFrom(loc);
+    }
+
+    void leaveContainment(entt::entity ent) {
+        auto con = registry.try_get<Containment>(ent);
+        auto loc = getLocation(ent);
+        if(!con || !registry.valid(loc)) return;
+        auto parent = registry.try_get<Containment>(loc);
+        if(parent && con->enter > parent->enter && con->exit + 1 == parent->nextFree) parent->nextFree = con->enter;
+    }
+
+    void rebuildContainment() {
+        registry.clear<Containment>();
+        for(auto ent : registry.view<Contents>()) {
+            if(!registry.valid(getLocation(ent))) layoutRoot(ent);
+        }
+    }
+
+    void rebuildContainment(const std::vector<entt::entity>& ents) {
+        std::unordered_set<entt::entity> placed(ents.begin(), ents.end());
+        // Only the outermost of them need placing; the rest are labelled along with those.
+        std::unordered_map<entt::entity, std::vector<entt::entity>> byHolder;
+        for(auto ent : ents) {
+            if(!registry.valid(ent)) continue;
+            auto loc = getLocation(ent);
+            if(!registry.valid(loc)) layoutRoot(ent);
+            else if(!placed.contains(loc)) byHolder[loc].push_back(ent);
+        }
+
+        std::unordered_map<entt::entity, std::size_t> sizes;
+        for(auto &[holder, group] : byHolder) {
+            if(!registry.all_of<Containment>(holder)) {
+                updateContainment(holder);
+                continue;
+            }
+            sizes.clear();
+            uint64_t total = 0;
+            for(auto ent : group) total += subtreeSize(ent, sizes);
+            auto &con = registry.get<Containment>(holder);
+            // A whole zone's worth arriving at once gets one layout rather than one per arrival.
+            if(con.exit - con.nextFree < reservePerEntity * total) {
+                relabelFrom(holder);
+                continue;
+            }
+            for(auto ent : group) placeInGap(ent, holder, sizes);
+        }
+    }
+
+    bool isInside(entt::entity ent, entt::entity container) {
+        if(ent == container || !registry.valid(ent) || !registry.valid(container)) return false;
+        auto inner = registry.try_get<Containment>(ent);
+        auto outer = registry.try_get<Containment>(container);
+        if(!inner || !outer || inner->root != outer->root) return false;
+        return outer->enter < inner->enter && inner->exit < outer->exit;
+    }
+
+    entt::entity getRootLocation(entt::entity ent) {
+        if(!registry.valid(ent)) return entt::null;
+        if(auto con = registry.try_get<Containment>(ent)) return con->root == ent ? entt::null : con->root;
+        return entt::null;
+    }
+
+    std::size_t getLocationDepth(entt::entity ent) {
+        if(!registry.valid(ent)) return 0;
+        if(auto con = registry.try_get<Containment>(ent)) return con->depth;
+        return 0;
+    }
+
+}
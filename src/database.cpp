@@ -3,308 +3,607 @@
 #include "core/api.h"
 #include "core/config.h"
 #include "core/link.h"
+#include "core/snapshot.h"
+#include "core/journal.h"
+#include "core/zone.h"
+#include "core/containment.h"
+#include "core/accounts.h"
+#include "core/prototype.h"
 
 namespace core {
 
-    std::vector<std::function<void(entt::entity,bool,nlohmann::json&)>> serializeFuncs;
-    nlohmann::json serializeEntity(entt::entity ent, bool asPrototype) {
-        nlohmann::json j;
-
-        auto name = registry.try_get<Name>(ent);
-        if (name) {
-            j["Name"] = name->data;
-        }
-
-        auto shortDescription = registry.try_get<ShortDescription>(ent);
-        if (shortDescription) {
-            j["ShortDescription"] = shortDescription->data;
-        }
-
-        auto roomDescription = registry.try_get<RoomDescription>(ent);
-        if (roomDescription) {
-            j["RoomDescription"] = roomDescription->data;
-        }
-
-        auto lookDescription = registry.try_get<LookDescription>(ent);
-        if(lookDescription) {
-            j["LookDescription"] = lookDescription->data;
-        }
-
-        if(!asPrototype) {
-            // Nab relationships...
-            auto location = registry.try_get<Location>(ent);
-            if (location) {
-                j["Location"] = registry.get<ObjectId>(location->data);
-            }
-
-            auto parent = registry.try_get<Parent>(ent);
-            if (parent) {
-                j["Parent"] = registry.get<ObjectId>(parent->data);
-            }
+    ObjectFormat getObjectFormat() {
+        return config::dbBinaryObjects ? ObjectFormat::MsgPack : ObjectFormat::JsonText;
+    }
 
-            auto owner = registry.try_get<Owner>(ent);
-            if (owner) {
-                j["Owner"] = registry.get<ObjectId>(owner->data);
+    std::vector<uint8_t> encodeObject(const nlohmann::json& j, ObjectFormat format) {
+        switch(format) {
+            case ObjectFormat::MsgPack:
+                return nlohmann::json::to_msgpack(j);
+            case ObjectFormat::JsonText:
+            default: {
+                auto txt = j.dump(-1, ' ', false, nlohmann::json::error_handler_t::ignore);
+                return {txt.begin(), txt.end()};
             }
         }
+    }
 
-
-
-
-        auto area = registry.try_get<Area>(ent);
-        if(area) {
-            nlohmann::json rooms;
-            for(auto &[rid, room] : area->data) {
-                rooms.push_back(std::make_pair(rid, serializeEntity(room, asPrototype)));
-            }
-            j["Area"] = rooms;
+    nlohmann::json decodeObject(ObjectFormat format, const void* data, std::size_t size) {
+        auto begin = static_cast<const uint8_t*>(data);
+        switch(format) {
+            case ObjectFormat::MsgPack:
+                return nlohmann::json::from_msgpack(begin, begin + size);
+            case ObjectFormat::JsonText:
+                return nlohmann::json::parse(begin, begin + size);
+            default:
+                throw std::runtime_error(fmt::format("Unknown object format {}", static_cast<int>(format)));
         }
+    }
 
-        auto expanse = registry.try_get<Expanse>(ent);
-        if(expanse) {
-            nlohmann::json e;
-            e["minX"] = expanse->minX;
-            e["minY"] = expanse->minY;
-            e["minZ"] = expanse->minZ;
-            e["maxX"] = expanse->maxX;
-            e["maxY"] = expanse->maxY;
-            e["maxZ"] = expanse->maxZ;
-
-            for(auto &[coor, poi] : expanse->poi) {
+    // While false, Rooms and points of interest are left out of their containers' json,
+    // because they are stored as rows of their own. See serializeEntity().
+    static bool includeSubEntities = true;
+    // Set while loadObjects() is hydrating. Rooms and points of interest found nested in an
+    // object's json come from before they had rows of their own, and are marked to get them.
+    static bool migrateNestedSubEntities = false;
+
+    // Shared by Expanse, Map and Space, which only differ in their component and point types.
+    template<typename T>
+    static void saveGrid(entt::entity ent, const T& grid, bool asPrototype, nlohmann::json& e) {
+        e["minX"] = grid.minX;
+        e["minY"] = grid.minY;
+        e["minZ"] = grid.minZ;
+        e["maxX"] = grid.maxX;
+        e["maxY"] = grid.maxY;
+        e["maxZ"] = grid.maxZ;
+
+        if(includeSubEntities) {
+            for(auto &[coor, poi] : grid.poi) {
                 nlohmann::json p;
                 p.push_back(coor.serialize());
                 p.push_back(serializeEntity(poi, asPrototype));
                 e["poi"].push_back(p);
             }
-            j["Expanse"] = e;
         }
+    }
 
-        auto map = registry.try_get<Map>(ent);
-        if(map) {
-            nlohmann::json e;
-            e["minX"] = map->minX;
-            e["minY"] = map->minY;
-            e["minZ"] = map->minZ;
-            e["maxX"] = map->maxX;
-            e["maxY"] = map->maxY;
-            e["maxZ"] = map->maxZ;
-
-            for(auto &[coor, poi] : map->poi) {
-                nlohmann::json p;
-                p.push_back(coor.serialize());
-                p.push_back(serializeEntity(poi, asPrototype));
-                e["poi"].push_back(p);
+    template<typename T, typename P>
+    static void loadGrid(entt::entity ent, const nlohmann::json& data, SubEntityKind kind) {
+        auto &exp = registry.get_or_emplace<T>(ent);
+        if(data.contains("minX")) exp.minX = data["minX"];
+        if(data.contains("minY")) exp.minY = data["minY"];
+        if(data.contains("minZ")) exp.minZ = data["minZ"];
+        if(data.contains("maxX")) exp.maxX = data["maxX"];
+        if(data.contains("maxY")) exp.maxY = data["maxY"];
+        if(data.contains("maxZ")) exp.maxZ = data["maxZ"];
+        if(data.contains("poi")) {
+            auto o = registry.get<ObjectId>(ent);
+            for(auto &poi : data["poi"]) {
+                P gp(poi[0]);
+                auto p = registry.create();
+                registry.get<T>(ent).poi.emplace(gp, p);
+                registry.emplace<PointOfInterest>(p, o, kind, gp);
+                deserializeEntity(p, poi[1]);
+                if(migrateNestedSubEntities) {
+                    setSubEntityDirty(p, true);
+                    setComponentsDirty(o, 0, true);
+                }
             }
-            j["Map"] = e;
         }
+    }
 
-        auto space = registry.try_get<Space>(ent);
-        if(space) {
-            nlohmann::json e;
-            e["minX"] = space->minX;
-            e["minY"] = space->minY;
-            e["minZ"] = space->minZ;
-            e["maxX"] = space->maxX;
-            e["maxY"] = space->maxY;
-            e["maxZ"] = space->maxZ;
-
-            for(auto &[coor, poi] : space->poi) {
-                nlohmann::json p;
-                p.push_back(coor.serialize());
-                p.push_back(serializeEntity(poi, asPrototype));
-                e["poi"].push_back(p);
-            }
-            j["Space"] = e;
-        }
+    // The order here is the order of deserialization, so relationships come after the
+    // simple components and the Room/POI containers after those.
+    static std::vector<ComponentSerializer> defaultComponentSerializers() {
+        std::vector<ComponentSerializer> out;
+
+        out.push_back(makeComponentSerializer<Name>("Name",
+            [](entt::entity ent, const Name& name, bool asPrototype, nlohmann::json& j) {
+                j = name.data;
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                registry.emplace<Name>(ent, j);
+            }));
+
+        out.push_back(makeComponentSerializer<ShortDescription>("ShortDescription",
+            [](entt::entity ent, const ShortDescription& desc, bool asPrototype, nlohmann::json& j) {
+                j = desc.data;
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                registry.emplace<ShortDescription>(ent, j);
+            }));
+
+        out.push_back(makeComponentSerializer<RoomDescription>("RoomDescription",
+            [](entt::entity ent, const RoomDescription& desc, bool asPrototype, nlohmann::json& j) {
+                j = desc.data;
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                registry.emplace<RoomDescription>(ent, j);
+            }));
+
+        out.push_back(makeComponentSerializer<LookDescription>("LookDescription",
+            [](entt::entity ent, const LookDescription& desc, bool asPrototype, nlohmann::json& j) {
+                j = desc.data;
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                registry.emplace<LookDescription>(ent, j);
+            }));
+
+        // Relationships are never part of a prototype.
+        out.push_back(makeComponentSerializer<Location>("Location",
+            [](entt::entity ent, const Location& location, bool asPrototype, nlohmann::json& j) {
+                if(asPrototype) return;
+                j = registry.get<ObjectId>(location.data);
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                ObjectId loc(j);
+                setLocation(ent, loc.getObject());
+            }));
+        // A relationship can't be copied onto an entity without its other side being told.
+        out.back().compile = {};
+
+        out.push_back(makeComponentSerializer<Parent>("Parent",
+            [](entt::entity ent, const Parent& parent, bool asPrototype, nlohmann::json& j) {
+                if(asPrototype) return;
+                j = registry.get<ObjectId>(parent.data);
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                ObjectId parent(j);
+                setParent(ent, parent.getObject());
+            }));
+        out.back().compile = {};
+
+        out.push_back(makeComponentSerializer<Owner>("Owner",
+            [](entt::entity ent, const Owner& owner, bool asPrototype, nlohmann::json& j) {
+                if(asPrototype) return;
+                j = registry.get<ObjectId>(owner.data);
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                ObjectId owner(j);
+                setOwner(ent, owner.getObject());
+            }));
+        out.back().compile = {};
+
+        out.push_back(makeComponentSerializer<Area>("Area",
+            [](entt::entity ent, const Area& area, bool asPrototype, nlohmann::json& j) {
+                j = nlohmann::json::array();
+                if(includeSubEntities) {
+                    for(auto &[rid, room] : area.data) {
+                        j.push_back(std::make_pair(rid, serializeEntity(room, asPrototype)));
+                    }
+                }
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                registry.get_or_emplace<Area>(ent);
+                auto o = registry.get<ObjectId>(ent);
+                for(auto &exdata : j) {
+                    auto r = exdata[0].get<RoomId>();
+                    auto room = registry.create();
+                    registry.get<Area>(ent).data.emplace(r, room);
+                    registry.emplace<Room>(room, o, r);
+                    deserializeEntity(room, exdata[1]);
+                    if(migrateNestedSubEntities) {
+                        setSubEntityDirty(room, true);
+                        setComponentsDirty(o, 0, true);
+                    }
+                }
+            }));
+        // Rooms and points of interest are entities of their own, which copies can't share.
+        out.back().compile = {};
+
+        out.push_back(makeComponentSerializer<Expanse>("Expanse", saveGrid<Expanse>,
+            [](entt::entity ent, const nlohmann::json& j) {
+                loadGrid<Expanse, GridPoint>(ent, j, SubEntityKind::ExpansePoi);
+            }));
+        out.back().compile = {};
+
+        out.push_back(makeComponentSerializer<Map>("Map", saveGrid<Map>,
+            [](entt::entity ent, const nlohmann::json& j) {
+                loadGrid<Map, GridPoint>(ent, j, SubEntityKind::MapPoi);
+            }));
+        out.back().compile = {};
+
+        out.push_back(makeComponentSerializer<Space>("Space", saveGrid<Space>,
+            [](entt::entity ent, const nlohmann::json& j) {
+                loadGrid<Space, SectorPoint>(ent, j, SubEntityKind::SpacePoi);
+            }));
+        out.back().compile = {};
+
+        out.push_back(makeComponentSerializer<GridLocation>("GridLocation",
+            [](entt::entity ent, const GridLocation& gloc, bool asPrototype, nlohmann::json& j) {
+                j = gloc.data.serialize();
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                registry.get_or_emplace<GridLocation>(ent, j);
+            }));
+
+        out.push_back(makeComponentSerializer<RoomLocation>("RoomLocation",
+            [](entt::entity ent, const RoomLocation& rloc, bool asPrototype, nlohmann::json& j) {
+                j = rloc.id;
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                auto &rloc = registry.get_or_emplace<RoomLocation>(ent);
+                rloc.id = j;
+                // TODO: Place ent in proper Room
+            }));
+
+        out.push_back(makeTagSerializer<Item>("Item"));
+        out.push_back(makeTagSerializer<Character>("Character"));
+        out.push_back(makeTagSerializer<NPC>("NPC"));
+
+        out.push_back(makeComponentSerializer<Player>("Player",
+            [](entt::entity ent, const Player& player, bool asPrototype, nlohmann::json& j) {
+                j["accountId"] = player.accountId;
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                auto &player = registry.get_or_emplace<Player>(ent);
+                player.accountId = j["accountId"];
+            }));
+
+        out.push_back(makeComponentSerializer<Room>("Room",
+            [](entt::entity ent, const Room& room, bool asPrototype, nlohmann::json& j) {
+                j["id"] = room.id;
+                j["obj"] = room.obj;
+            },
+            [](entt::entity ent, const nlohmann::json& j) {
+                auto &room = registry.get_or_emplace<Room>(ent);
+                room.id = j["id"];
+                room.obj = ObjectId(j["obj"]);
+            }));
+        // Each Room is keyed by its place in its Area; a copy would claim the same place.
+        out.back().compile = {};
+
+        out.push_back(makeTagSerializer<Vehicle>("Vehicle"));
+
+        return out;
+    }
 
-        auto gloc = registry.try_get<GridLocation>(ent);
-        if(gloc) {
-            j["GridLocation"] = gloc->data.serialize();
-        }
+    std::vector<ComponentSerializer> componentSerializers = defaultComponentSerializers();
 
-        auto rloc = registry.try_get<RoomLocation>(ent);
-        if(rloc) {
-            j["RoomLocation"] = rloc->id;
+    std::size_t registerComponentSerializer(ComponentSerializer serializer) {
+        // Compiled prototypes hold on to the old serializers' decoded values.
+        clearPrototypeCache();
+        if(auto idx = getComponentSerializerIndex(serializer.key)) {
+            componentSerializers[*idx] = std::move(serializer);
+            return *idx;
         }
+        componentSerializers.push_back(std::move(serializer));
+        return componentSerializers.size() - 1;
+    }
 
-        auto player = registry.try_get<Player>(ent);
-        if(player) {
-            j["Player"]["accountId"] = player->accountId;
+    std::optional<std::size_t> getComponentSerializerIndex(std::string_view key) {
+        for(std::size_t i = 0; i < componentSerializers.size(); i++) {
+            if(componentSerializers[i].key == key) return i;
         }
+        return std::nullopt;
+    }
 
-        auto room = registry.try_get<Room>(ent);
-        if(room) {
-            nlohmann::json r;
-            r["id"] = room->id;
-            r["obj"] = room->obj;
-            j["Room"] = r;
-        }
+    std::optional<nlohmann::json> serializeComponent(entt::entity ent, std::size_t index, bool asPrototype) {
+        auto &serializer = componentSerializers.at(index);
+        // Fragments are only ever saved to the database, which keeps sub-entities in rows of their own.
+        FlagGuard guard(includeSubEntities, false);
+        nlohmann::json j;
+        serializer.save(ent, asPrototype, j);
+        if(!j.contains(serializer.key)) return std::nullopt;
+        return std::move(j[serializer.key]);
+    }
 
-        if(registry.any_of<Character>(ent)) j["Character"] = true;
-        if(registry.any_of<NPC>(ent)) j["NPC"] = true;
-        if(registry.any_of<Item>(ent)) j["Item"] = true;
+    std::vector<std::function<void(entt::entity,bool,nlohmann::json&)>> serializeFuncs;
+    nlohmann::json serializeEntity(entt::entity ent, bool asPrototype, bool withSubEntities) {
+        FlagGuard guard(includeSubEntities, withSubEntities);
+        nlohmann::json j;
 
-        if(registry.any_of<Vehicle>(ent)) j["Vehicle"] = true;
+        for(auto& serializer : componentSerializers) serializer.save(ent, asPrototype, j);
 
         for(auto& func : serializeFuncs) func(ent, false, j);
 
         return j;
     }
 
-    std::vector<std::function<void(entt::entity, const nlohmann::json&)>> deserializeFuncs;
-    void deserializeEntity(entt::entity ent, const nlohmann::json& j) {
-        if(j.contains("Name")) {
-            registry.emplace<Name>(ent, j["Name"]);
-        }
-        if(j.contains("ShortDescription")) {
-            registry.emplace<ShortDescription>(ent, j["ShortDescription"]);
-        }
-        if(j.contains("RoomDescription")) {
-            registry.emplace<RoomDescription>(ent, j["RoomDescription"]);
-        }
-        if(j.contains("LookDescription")) {
-            registry.emplace<LookDescription>(ent, j["LookDescription"]);
+    // A serializer's storage is walked in full when it holds no more than this many components
+    // per entity being saved; past that, probing each entity is cheaper.
+    static constexpr std::size_t bulkStorageRatio = 4;
+
+    std::vector<nlohmann::json> serializeEntities(const std::vector<entt::entity>& ents, bool asPrototype,
+            bool withSubEntities, const std::function<bool(const ComponentSerializer&)>& filter) {
+        FlagGuard guard(includeSubEntities, withSubEntities);
+        std::vector<nlohmann::json> out(ents.size());
+
+        // Maps an entity's index to its place in out, so that storage order can be scattered into it.
+        constexpr auto none = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> slots;
+        for(std::size_t i = 0; i < ents.size(); i++) {
+            if(ents[i] == entt::null) continue;
+            auto idx = static_cast<std::size_t>(entt::to_entity(ents[i]));
+            if(idx >= slots.size()) slots.resize(idx + 1, none);
+            slots[idx] = static_cast<uint32_t>(i);
         }
-
-        if(j.contains("Location")) {
-            ObjectId loc(j["Location"]);
-            setLocation(ent, loc.getObject());
+        std::function<nlohmann::json*(entt::entity)> recordFor = [&](entt::entity ent) -> nlohmann::json* {
+            auto idx = static_cast<std::size_t>(entt::to_entity(ent));
+            if(idx >= slots.size() || slots[idx] == none) return nullptr;
+            // The versions must match too, or it's a different entity in a recycled slot.
+            if(ents[slots[idx]] != ent) return nullptr;
+            return &out[slots[idx]];
+        };
+
+        for(auto &serializer : componentSerializers) {
+            if(filter && !filter(serializer)) continue;
+            if(serializer.saveAll && serializer.count && serializer.count() <= ents.size() * bulkStorageRatio) {
+                serializer.saveAll(asPrototype, recordFor);
+                continue;
+            }
+            for(std::size_t i = 0; i < ents.size(); i++) {
+                if(ents[i] != entt::null) serializer.save(ents[i], asPrototype, out[i]);
+            }
         }
 
-        if(j.contains("Parent")) {
-            ObjectId parent(j["Parent"]);
-            setParent(ent, parent.getObject());
+        for(std::size_t i = 0; i < ents.size(); i++) {
+            if(ents[i] == entt::null) continue;
+            for(auto& func : serializeFuncs) func(ents[i], false, out[i]);
         }
 
-        if(j.contains("Owner")) {
-            ObjectId owner(j["Owner"]);
-            setOwner(ent, owner.getObject());
-        }
+        return out;
+    }
 
-        if(j.contains("Area")) {
-            auto &rooms = registry.get_or_emplace<Area>(ent);
-            auto &o = registry.get<ObjectId>(ent);
-            for(auto &exdata : j["Area"]) {
-                auto r = exdata[0].get<RoomId>();
-                auto room = registry.create();
-                rooms.data.emplace(r, room);
-                deserializeEntity(room, exdata[1]);
-                auto &rm = registry.get_or_emplace<Room>(room);
-                rm.obj = o;
-                rm.id = r;
+    std::vector<std::function<void(entt::entity, const nlohmann::json&)>> deserializeFuncs;
+    void deserializeEntity(entt::entity ent, const nlohmann::json& j) {
+        for(auto& serializer : componentSerializers) {
+            if(auto found = j.find(serializer.key); found != j.end()) {
+                serializer.load(ent, *found);
             }
         }
 
-        if(j.contains("Expanse")) {
-            auto &exp = registry.get_or_emplace<Expanse>(ent);
-            auto &data = j["Expanse"];
-            if(data.contains("minX")) exp.minX = data["minX"];
-            if(data.contains("minY")) exp.minY = data["minY"];
-            if(data.contains("minZ")) exp.minZ = data["minZ"];
-            if(data.contains("maxX")) exp.maxX = data["maxX"];
-            if(data.contains("maxY")) exp.maxY = data["maxY"];
-            if(data.contains("maxZ")) exp.maxZ = data["maxZ"];
-            if(data.contains("poi")) {
-                for(auto &poi : data["poi"]) {
-                    GridPoint gp(poi[0]);
-                    auto p = registry.create();
-                    exp.poi.emplace(gp, p);
-                    deserializeEntity(p, poi[1]);
-                }
-            }
+        for(auto &func : deserializeFuncs) func(ent, j);
+
+    }
+
+    void markComponentDirty(entt::entity ent, std::size_t index) {
+        if(gameIsLoading || !registry.valid(ent)) return;
+        if(auto id = registry.try_get<ObjectId>(ent)) {
+            setComponentsDirty(*id, index < 64 ? (uint64_t(1) << index) : 0);
+            return;
         }
+        // Rooms and points of interest are saved as a whole row each.
+        setSubEntityDirty(ent);
+    }
 
-        if(j.contains("Map")) {
-            auto &exp = registry.get_or_emplace<Map>(ent);
-            auto &data = j["Map"];
-            if(data.contains("minX")) exp.minX = data["minX"];
-            if(data.contains("minY")) exp.minY = data["minY"];
-            if(data.contains("minZ")) exp.minZ = data["minZ"];
-            if(data.contains("maxX")) exp.maxX = data["maxX"];
-            if(data.contains("maxY")) exp.maxY = data["maxY"];
-            if(data.contains("maxZ")) exp.maxZ = data["maxZ"];
-            if(data.contains("poi")) {
-                for(auto &poi : data["poi"]) {
-                    GridPoint gp(poi[0]);
-                    auto p = registry.create();
-                    exp.poi.emplace(gp, p);
-                    deserializeEntity(p, poi[1]);
-                }
-            }
+    std::unordered_set<SubEntityKey> dirtySubEntities;
+
+    std::optional<SubEntityKey> getSubEntityKey(entt::entity ent) {
+        if(auto room = registry.try_get<Room>(ent)) {
+            return SubEntityKey{room->obj, SubEntityKind::Room, room->id};
+        }
+        if(auto poi = registry.try_get<PointOfInterest>(ent)) {
+            return SubEntityKey{poi->obj, poi->kind, poi->point};
         }
+        return std::nullopt;
+    }
 
-        if(j.contains("Space")) {
-            auto &exp = registry.get_or_emplace<Space>(ent);
-            auto &data = j["Space"];
-            if(data.contains("minX")) exp.minX = data["minX"];
-            if(data.contains("minY")) exp.minY = data["minY"];
-            if(data.contains("minZ")) exp.minZ = data["minZ"];
-            if(data.contains("maxX")) exp.maxX = data["maxX"];
-            if(data.contains("maxY")) exp.maxY = data["maxY"];
-            if(data.contains("maxZ")) exp.maxZ = data["maxZ"];
-            if(data.contains("poi")) {
-                for(auto &poi : data["poi"]) {
-                    SectorPoint gp(poi[0]);
-                    auto p = registry.create();
-                    exp.poi.emplace(gp, p);
-                    deserializeEntity(p, poi[1]);
+    template<typename T, typename P>
+    static entt::entity findPoi(entt::entity owner, const DestinationType& point) {
+        auto grid = registry.try_get<T>(owner);
+        auto p = std::get_if<P>(&point);
+        if(!grid || !p) return entt::null;
+        auto found = grid->poi.find(*p);
+        return found == grid->poi.end() ? entt::null : found->second;
+    }
+
+    entt::entity findSubEntity(const SubEntityKey& key) {
+        auto owner = key.owner.getObject();
+        if(!registry.valid(owner)) return entt::null;
+        entt::entity found = entt::null;
+        switch(key.kind) {
+            case SubEntityKind::Room:
+                if(auto area = registry.try_get<Area>(owner)) {
+                    if(auto id = std::get_if<RoomId>(&key.point)) {
+                        auto it = area->data.find(*id);
+                        if(it != area->data.end()) found = it->second;
+                    }
                 }
-            }
+                break;
+            case SubEntityKind::ExpansePoi:
+                found = findPoi<Expanse, GridPoint>(owner, key.point);
+                break;
+            case SubEntityKind::MapPoi:
+                found = findPoi<Map, GridPoint>(owner, key.point);
+                break;
+            case SubEntityKind::SpacePoi:
+                found = findPoi<Space, SectorPoint>(owner, key.point);
+                break;
         }
+        return registry.valid(found) ? found : entt::null;
+    }
 
-        if(j.contains("GridLocation")) {
-            auto &gloc = registry.get_or_emplace<GridLocation>(ent, j["GridLocation"]);
-        }
+    std::string subEntityKeyString(const DestinationType& point) {
+        if(auto id = std::get_if<RoomId>(&point)) return std::to_string(*id);
+        if(auto gp = std::get_if<GridPoint>(&point)) return gp->serialize().dump();
+        return std::get<SectorPoint>(point).serialize().dump();
+    }
 
-        if(j.contains("RoomLocation")) {
-            auto &rloc = registry.get_or_emplace<RoomLocation>(ent);
-            rloc.id = j["RoomLocation"];
-            // TODO: Place ent in proper Room
+    static DestinationType parseSubEntityKey(SubEntityKind kind, const std::string& key) {
+        switch(kind) {
+            case SubEntityKind::Room:
+                return static_cast<RoomId>(std::stoull(key));
+            case SubEntityKind::SpacePoi:
+                return SectorPoint(nlohmann::json::parse(key));
+            default:
+                return GridPoint(nlohmann::json::parse(key));
         }
+    }
 
-        if(j.contains("Item")) {
-            registry.get_or_emplace<Item>(ent);
+    void setSubEntityDirty(entt::entity ent, bool override) {
+        if(gameIsLoading && !override) return;
+        if(auto key = getSubEntityKey(ent)) {
+            if(registry.valid(key->owner.getObject())) dirtySubEntities.insert(*key);
         }
+    }
 
-        if(j.contains("Character")) {
-            registry.get_or_emplace<Character>(ent);
+    void setComponentDirty(entt::entity ent, std::string_view key) {
+        if(auto idx = getComponentSerializerIndex(key)) {
+            markComponentDirty(ent, *idx);
+        } else {
+            // Something we can't save by itself; fall back to a full save.
+            setDirty(ent);
         }
+    }
 
-        if(j.contains("NPC")) {
-            registry.get_or_emplace<NPC>(ent);
-        }
+    static void onSubEntityChanged(entt::registry& reg, entt::entity ent) {
+        setSubEntityDirty(ent);
+    }
 
-        if(j.contains("Player")) {
-            auto &pdata = j["Player"];
-            auto &player = registry.get_or_emplace<Player>(ent);
-            player.accountId = pdata["accountId"];
-        }
+    void watchComponents() {
+        watchComponent<Name>("Name");
+        watchComponent<ShortDescription>("ShortDescription");
+        watchComponent<RoomDescription>("RoomDescription");
+        watchComponent<LookDescription>("LookDescription");
+        watchComponent<Location>("Location");
+        watchComponent<Parent>("Parent");
+        watchComponent<Owner>("Owner");
+        watchComponent<Area>("Area");
+        watchComponent<Expanse>("Expanse");
+        watchComponent<Map>("Map");
+        watchComponent<Space>("Space");
+        watchComponent<GridLocation>("GridLocation");
+        watchComponent<RoomLocation>("RoomLocation");
+        watchComponent<Item>("Item");
+        watchComponent<Character>("Character");
+        watchComponent<NPC>("NPC");
+        watchComponent<Player>("Player");
+        watchComponent<Room>("Room");
+        watchComponent<Vehicle>("Vehicle");
+
+        // Becoming a Room/point of interest means it needs a row, and ceasing to be one
+        // means its row must go.
+        registry.on_construct<Room>().connect<&onSubEntityChanged>();
+        registry.on_construct<PointOfInterest>().connect<&onSubEntityChanged>();
+        registry.on_destroy<Room>().connect<&onSubEntityChanged>();
+        registry.on_destroy<PointOfInterest>().connect<&onSubEntityChanged>();
+
+        // A destroyed object's slot goes back on the free list.
+        registry.on_destroy<ObjectId>().connect<&onObjectIdDestroyed>();
+    }
+
+    std::unique_ptr<SQLite::Database> db;
+
+    CachedStatement::CachedStatement(CachedStatement&& other) noexcept
+        : statement(other.statement), inUse(other.inUse), owned(std::move(other.owned)) {
+        other.statement = nullptr;
+        other.inUse = nullptr;
+    }
+
+    CachedStatement::~CachedStatement() {
+        if(!statement) return;
+        statement->tryReset();
+        if(inUse) *inUse = false;
+    }
 
-        if(j.contains("Room")) {
-            auto &rdata = j["Room"];
-            auto &room = registry.get_or_emplace<Room>(ent);
-            room.id = rdata["id"];
-            room.obj = ObjectId(rdata["obj"]);
+    CachedStatement StatementCache::get(std::string_view sql) {
+        auto found = statements.find(sql);
+        if(found == statements.end()) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            found = statements.emplace(std::string(sql), Entry{std::make_unique<SQLite::Statement>(conn, std::string(sql))}).first;
+        } else if(found->second.inUse) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return CachedStatement(std::make_unique<SQLite::Statement>(conn, std::string(sql)));
+        } else {
+            hits.fetch_add(1, std::memory_order_relaxed);
         }
+        auto &entry = found->second;
+        entry.statement->clearBindings();
+        entry.inUse = true;
+        return {entry.statement.get(), &entry.inUse};
+    }
 
-        if(j.contains("Vehicle")) {
-            registry.get_or_emplace<Vehicle>(ent);
+    void StatementCache::clear() {
+        statements.clear();
+    }
+
+    // Declared after db, so that it's destroyed first and the statements are finalized while
+    // their connection is still open.
+    static std::mutex statementCachesMutex;
+    static std::unordered_map<SQLite::Database*, std::unique_ptr<StatementCache>> statementCaches;
+    static std::atomic<uint64_t> droppedHits{0}, droppedMisses{0};
+
+    StatementCache& getStatementCache(SQLite::Database& conn) {
+        std::lock_guard<std::mutex> lock(statementCachesMutex);
+        auto &cache = statementCaches[&conn];
+        if(!cache) cache = std::make_unique<StatementCache>(conn);
+        return *cache;
+    }
+
+    void dropStatementCache(SQLite::Database& conn) {
+        std::lock_guard<std::mutex> lock(statementCachesMutex);
+        if(auto found = statementCaches.find(&conn); found != statementCaches.end()) {
+            droppedHits += found->second->getHits();
+            droppedMisses += found->second->getMisses();
+            statementCaches.erase(found);
         }
+    }
 
-        for(auto &func : deserializeFuncs) func(ent, j);
+    CachedStatement prepare(SQLite::Database& conn, std::string_view sql) {
+        return getStatementCache(conn).get(sql);
+    }
 
+    uint64_t getStatementCacheHits() {
+        std::lock_guard<std::mutex> lock(statementCachesMutex);
+        uint64_t total = droppedHits;
+        for(auto &[conn, cache] : statementCaches) total += cache->getHits();
+        return total;
     }
 
-    std::unique_ptr<SQLite::Database> db;
+    uint64_t getStatementCacheMisses() {
+        std::lock_guard<std::mutex> lock(statementCachesMutex);
+        uint64_t total = droppedMisses;
+        for(auto &[conn, cache] : statementCaches) total += cache->getMisses();
+        return total;
+    }
 
     std::vector<std::string> schema = {
             "CREATE TABLE IF NOT EXISTS objects ("
             "   id INTEGER PRIMARY KEY,"
             "   generation INTEGER NOT NULL,"
-            "   data TEXT NOT NULL,"
+            "   format INTEGER NOT NULL DEFAULT 0,"
+            "   data BLOB NOT NULL,"
+            "   location INTEGER,"
+            "   isZone INTEGER NOT NULL DEFAULT 0,"
             "   UNIQUE(id, generation)"
             ");",
 
+            // Component fragments saved since the object's row in objects was last written in full.
+            // They are layered over that row at load time. A NULL data means the component was removed.
+            "CREATE TABLE IF NOT EXISTS object_components ("
+            "   id INTEGER NOT NULL,"
+            "   component TEXT NOT NULL,"
+            "   format INTEGER NOT NULL DEFAULT 0,"
+            "   data BLOB,"
+            "   PRIMARY KEY(id, component)"
+            ");",
+
+            // Bookkeeping values. 'epoch' is bumped by every transaction which writes objects, so
+            // that anything derived from them, like a snapshot, can tell if it's stale.
+            "CREATE TABLE IF NOT EXISTS meta ("
+            "   key TEXT PRIMARY KEY,"
+            "   value INTEGER NOT NULL DEFAULT 0"
+            ");",
+
+            "INSERT OR IGNORE INTO meta (key, value) VALUES ('epoch', 0);",
+
+            // The highest generation ever saved, so that a slot reused after a restart never gets
+            // the generation of something that was deleted from it. See nextObjectGeneration().
+            "INSERT OR IGNORE INTO meta (key, value) VALUES ('generation', 0);",
+
+            // Rooms of an Area, and points of interest of an Expanse/Map/Space, one row each so
+            // that editing one doesn't rewrite its whole container. kind is a SubEntityKind, and
+            // key is the output of subEntityKeyString().
+            "CREATE TABLE IF NOT EXISTS object_subentities ("
+            "   owner INTEGER NOT NULL,"
+            "   kind INTEGER NOT NULL,"
+            "   key TEXT NOT NULL,"
+            "   format INTEGER NOT NULL DEFAULT 0,"
+            "   data BLOB NOT NULL,"
+            "   PRIMARY KEY(owner, kind, key)"
+            ");",
+
             "CREATE TABLE IF NOT EXISTS prototypes ("
             "   id INTEGER PRIMARY KEY,"
             "   name TEXT NOT NULL UNIQUE COLLATE NOCASE,"
@@ -339,81 +638,838 @@ namespace core {
             ");",
     };
 
-    // Presumably this will only be called if there ARE any dirties.
-    void processDirty() {
+    std::unique_ptr<DatabaseWriter> dbWriter;
+
+    DatabaseWriter::~DatabaseWriter() {
+        stop();
+    }
+
+    void DatabaseWriter::start() {
+        if(running) return;
+        conn = std::make_unique<SQLite::Database>(config::dbName, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        conn->setBusyTimeout(5000);
+        applyStoragePragmas(*conn);
+        stopping = false;
+        running = true;
+        thread = std::thread([this]() { run(); });
+    }
+
+    void DatabaseWriter::stop() {
+        if(!running) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+        dropStatementCache(*conn);
+        logger->info("Prepared statement cache: {} hits, {} misses.", getStatementCacheHits(), getStatementCacheMisses());
+        conn.reset();
+        running = false;
+    }
 
-        SQLite::Statement q1(*db, "INSERT OR REPLACE INTO objects (id, generation, data) VALUES (?, ?, ?);");
-        SQLite::Statement q2(*db, "DELETE FROM objects WHERE id = ? AND generation = ?;");
+    void DatabaseWriter::submit(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+    void DatabaseWriter::flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return jobs.empty() && !busy; });
+    }
+
+    std::size_t DatabaseWriter::pending() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return jobs.size() + (busy ? 1 : 0);
+    }
+
+    void DatabaseWriter::reportResult(SaveResult result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(std::move(result));
+    }
 
-        for(auto &obj : dirty) {
+    std::vector<SaveResult> DatabaseWriter::takeResults() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<SaveResult> out;
+        out.swap(results);
+        return out;
+    }
+
+    void DatabaseWriter::run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if(jobs.empty()) {
+                // stopping, and nothing left to do.
+                break;
+            }
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            busy = true;
+            lock.unlock();
+            try {
+                job(*conn);
+            } catch(std::exception& e) {
+                logger->error("DatabaseWriter: job failed: {}", e.what());
+            }
+            lock.lock();
+            busy = false;
+            if(jobs.empty()) idle.notify_all();
+        }
+        idle.notify_all();
+    }
+
+    static void bindLocation(SQLite::Statement& q, int index, int64_t location) {
+        if(location < 0) q.bind(index);
+        else q.bind(index, location);
+    }
+
+    SaveResult writeSnapshots(SQLite::Database& conn, std::vector<ObjectSnapshot>& batch) {
+        SaveResult result;
+        auto started = std::chrono::steady_clock::now();
+
+        auto q1 = prepare(conn, "INSERT OR REPLACE INTO objects (id, generation, format, data, location, isZone) VALUES (?, ?, ?, ?, ?, ?);");
+        auto q2 = prepare(conn, "DELETE FROM objects WHERE id = ? AND generation = ?;");
+        auto q3 = prepare(conn, "DELETE FROM object_components WHERE id = ?;");
+        // A fragment may arrive for an object which has never been saved in full.
+        auto q4 = prepare(conn, "INSERT OR IGNORE INTO objects (id, generation, format, data) VALUES (?, ?, 0, '{}');");
+        auto q5 = prepare(conn, "INSERT OR REPLACE INTO object_components (id, component, format, data) VALUES (?, ?, ?, ?);");
+        auto q6 = prepare(conn, "UPDATE meta SET value = value + 1 WHERE key = 'epoch';");
+        auto q7 = prepare(conn, "INSERT OR REPLACE INTO object_subentities (owner, kind, key, format, data) VALUES (?, ?, ?, ?, ?);");
+        auto q8 = prepare(conn, "DELETE FROM object_subentities WHERE owner = ? AND kind = ? AND key = ?;");
+        auto q9 = prepare(conn, "DELETE FROM object_subentities WHERE owner = ?;");
+        auto q10 = prepare(conn, "UPDATE objects SET location = ?, isZone = ? WHERE id = ?;");
+        auto q11 = prepare(conn, "UPDATE meta SET value = MAX(value, ?) WHERE key = 'generation';");
+
+        // Each transaction costs one sync, so we batch the snapshots into chunks. A chunk
+        // that fails to commit is rolled back by the Transaction's destructor.
+        auto chunkSize = std::max<std::size_t>(config::dbSaveChunkSize, 1);
+        auto format = getObjectFormat();
+
+        try {
+            for(std::size_t start = 0; start < batch.size(); start += chunkSize) {
+                auto end = std::min(start + chunkSize, batch.size());
+                SQLite::Transaction trans(conn);
+                int64_t maxGeneration = 0;
+                for(auto i = start; i < end; i++) {
+                    auto &snap = batch[i];
+                    maxGeneration = std::max(maxGeneration, snap.id.generation);
+                    auto &obj = snap.id;
+                    auto &data = snap.data;
+                    auto &components = snap.components;
+                    auto &subEntities = snap.subEntities;
+                    auto id = static_cast<int64_t>(obj.index);
+                    if(snap.isDeletion()) {
+                        q2->bind(1, id);
+                        q2->bind(2, obj.generation);
+                        q2->exec();
+                        q2->reset();
+                        q3->bind(1, id);
+                        q3->exec();
+                        q3->reset();
+                        q9->bind(1, id);
+                        q9->exec();
+                        q9->reset();
+                        result.deleted++;
+                        continue;
+                    }
+                    if(data) {
+                        // A full save folds away any fragments.
+                        q3->bind(1, id);
+                        q3->exec();
+                        q3->reset();
+                        auto encoded = encodeObject(*data, format);
+                        q1->bind(1, id);
+                        q1->bind(2, obj.generation);
+                        q1->bind(3, static_cast<int>(format));
+                        q1->bind(4, encoded.data(), static_cast<int>(encoded.size()));
+                        bindLocation(*q1, 5, snap.location);
+                        q1->bind(6, snap.isZone ? 1 : 0);
+                        q1->exec();
+                        q1->reset();
+                        result.saved++;
+                    } else if(!components.empty() || !subEntities.empty()) {
+                        q4->bind(1, id);
+                        q4->bind(2, obj.generation);
+                        q4->exec();
+                        q4->reset();
+                        bindLocation(*q10, 1, snap.location);
+                        q10->bind(2, snap.isZone ? 1 : 0);
+                        q10->bind(3, id);
+                        q10->exec();
+                        q10->reset();
+                        for(auto &[key, value] : components) {
+                            q5->bind(1, id);
+                            q5->bind(2, key);
+                            q5->bind(3, static_cast<int>(format));
+                            std::vector<uint8_t> encoded;
+                            if(value) {
+                                encoded = encodeObject(*value, format);
+                                q5->bind(4, encoded.data(), static_cast<int>(encoded.size()));
+                            } else {
+                                q5->bind(4);
+                            }
+                            q5->exec();
+                            q5->reset();
+                            result.fragments++;
+                        }
+                    }
+                    for(auto &[kind, key, value] : snap.subEntities) {
+                        if(value) {
+                            auto encoded = encodeObject(*value, format);
+                            q7->bind(1, id);
+                            q7->bind(2, static_cast<int>(kind));
+                            q7->bind(3, key);
+                            q7->bind(4, static_cast<int>(format));
+                            q7->bind(5, encoded.data(), static_cast<int>(encoded.size()));
+                            q7->exec();
+                            q7->reset();
+                        } else {
+                            q8->bind(1, id);
+                            q8->bind(2, static_cast<int>(kind));
+                            q8->bind(3, key);
+                            q8->exec();
+                            q8->reset();
+                        }
+                        result.subEntities++;
+                    }
+                }
+                q6->exec();
+                q6->reset();
+                q11->bind(1, maxGeneration);
+                q11->exec();
+                q11->reset();
+                trans.commit();
+            }
+        } catch(std::exception& e) {
+            result.error = e.what();
+        }
+
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+
+    static uint64_t saveBatchCounter{0};
+
+    static void placeSnapshot(ObjectSnapshot& snap, entt::entity ent) {
+        auto loc = getLocation(ent);
+        if(registry.valid(loc)) snap.location = static_cast<int64_t>(registry.get<ObjectId>(loc).index);
+        snap.isZone = isZone(ent);
+    }
+
+    // Roughly how many bytes j will take once encoded. Only meant for budgeting.
+    static std::size_t approximateSize(const nlohmann::json& j) {
+        switch(j.type()) {
+            case nlohmann::json::value_t::object: {
+                std::size_t total = 1;
+                for(auto &[key, value] : j.items()) total += key.size() + 1 + approximateSize(value);
+                return total;
+            }
+            case nlohmann::json::value_t::array: {
+                std::size_t total = 1;
+                for(auto &value : j) total += approximateSize(value);
+                return total;
+            }
+            case nlohmann::json::value_t::string:
+                return j.get_ref<const std::string&>().size() + 1;
+            default:
+                return 9;
+        }
+    }
+
+    static std::size_t snapshotFragments(const ObjectId& obj, uint64_t mask, std::vector<ObjectSnapshot>& batch) {
+        auto ent = obj.getObject();
+        // A deleted object is expected to be in dirty; there's nothing to save here.
+        if(!registry.valid(ent)) return 0;
+        ObjectSnapshot snap{obj, std::nullopt, {}, {}};
+        std::size_t bytes = 0;
+        for(std::size_t i = 0; i < componentSerializers.size() && i < 64; i++) {
+            if(!(mask & (uint64_t(1) << i))) continue;
+            auto value = serializeComponent(ent, i);
+            if(value) bytes += approximateSize(*value);
+            snap.components.emplace_back(componentSerializers[i].key, std::move(value));
+        }
+        if(snap.components.empty()) return 0;
+        placeSnapshot(snap, ent);
+        batch.push_back(std::move(snap));
+        return bytes + 1;
+    }
+
+    // Sub-entities ride along with their owner's snapshot in ownerIndex, or get one of their own.
+    static std::size_t snapshotSubEntity(const SubEntityKey& key, std::vector<ObjectSnapshot>& batch,
+                                         std::unordered_map<ObjectId, std::size_t>& ownerIndex) {
+        auto owner = key.owner.getObject();
+        if(!registry.valid(owner)) return 0;
+        auto found = ownerIndex.find(key.owner);
+        if(found == ownerIndex.end()) {
+            auto &snap = batch.emplace_back(ObjectSnapshot{key.owner, std::nullopt, {}, {}});
+            placeSnapshot(snap, owner);
+            found = ownerIndex.emplace(key.owner, batch.size() - 1).first;
+        }
+        std::optional<nlohmann::json> data;
+        auto sub = findSubEntity(key);
+        if(registry.valid(sub)) data = serializeEntity(sub, false, false);
+        auto bytes = data ? approximateSize(*data) : 0;
+        batch[found->second].subEntities.emplace_back(key.kind, subEntityKeyString(key.point), std::move(data));
+        return bytes + 1;
+    }
+
+    std::size_t snapshotDirtyObject(const ObjectId& obj, std::vector<ObjectSnapshot>& batch) {
+        if(dirty.erase(obj)) {
+            dirtyComponents.erase(obj);
+            auto ent = obj.getObject();
+            if(!registry.valid(ent)) {
+                batch.push_back({obj, std::nullopt, {}, {}});
+                return 1;
+            }
+            auto &snap = batch.emplace_back(ObjectSnapshot{obj, serializeEntity(ent, false, false), {}, {}});
+            placeSnapshot(snap, ent);
+            return approximateSize(*snap.data);
+        }
+        if(auto mask = dirtyComponents.mask(obj); dirtyComponents.erase(obj)) {
+            return snapshotFragments(obj, mask, batch);
+        }
+        return 0;
+    }
+
+    std::size_t snapshotDirtySubEntity(const SubEntityKey& key, std::vector<ObjectSnapshot>& batch) {
+        if(!dirtySubEntities.erase(key)) return 0;
+        std::unordered_map<ObjectId, std::size_t> ownerIndex;
+        return snapshotSubEntity(key, batch, ownerIndex);
+    }
+
+    uint64_t submitSnapshots(std::vector<ObjectSnapshot> batch) {
+        auto batchId = ++saveBatchCounter;
+
+        if(journal && dbWriter && dbWriter->isRunning()) {
+            submitToJournal(std::move(batch), batchId);
+        } else if(dbWriter && dbWriter->isRunning()) {
+            dbWriter->submit([batchId, batch = std::move(batch)](SQLite::Database& conn) mutable {
+                auto result = writeSnapshots(conn, batch);
+                result.batch = batchId;
+                dbWriter->reportResult(std::move(result));
+            });
+        } else {
+            auto result = writeSnapshots(*db, batch);
+            result.batch = batchId;
+            for(auto &func : saveResultFuncs) func(result);
+            if(result.error) logger->error("Save batch {} failed: {}", batchId, *result.error);
+        }
+        return batchId;
+    }
+
+    // Presumably this will only be called if there ARE any dirties.
+    void processDirty() {
+        if(dirty.empty() && dirtyComponents.empty() && dirtySubEntities.empty()) return;
+
+        // Snapshotting is the only part which touches the registry, so it's the only part
+        // which must happen here on the game strand. Encoding and disk I/O belong to the writer.
+        std::vector<ObjectSnapshot> batch;
+        batch.reserve(dirty.size() + dirtyComponents.size());
+        // Full saves are serialized together, storage by storage.
+        std::vector<entt::entity> fullEnts;
+        fullEnts.reserve(dirty.size());
+        for(auto obj : dirty) {
             auto ent = obj.getObject();
-            if(registry.valid(ent)) {
-                q1.bind(1, static_cast<int64_t>(obj.index));
-                q1.bind(2, obj.generation);
-                q1.bind(3, serializeEntity(ent).dump(4, ' ', false, nlohmann::json::error_handler_t::ignore));
-                q1.exec();
-                q1.reset();
+            fullEnts.push_back(registry.valid(ent) ? ent : entt::null);
+        }
+        // Rooms and points of interest have rows of their own, see below.
+        auto fullData = serializeEntities(fullEnts, false, false);
+        std::size_t fullIndex = 0;
+        for(auto obj : dirty) {
+            auto ent = fullEnts[fullIndex];
+            auto &data = fullData[fullIndex++];
+            if(ent != entt::null) {
+                auto &snap = batch.emplace_back(ObjectSnapshot{obj, std::move(data), {}, {}});
+                placeSnapshot(snap, ent);
             } else {
-                q2.bind(1, static_cast<int64_t>(obj.index));
-                q2.bind(2, obj.generation);
-                q2.exec();
-                q2.reset();
+                batch.push_back({obj, std::nullopt, {}, {}});
             }
         }
 
+        for(auto obj : dirtyComponents) {
+            if(dirty.contains(obj)) continue;
+            snapshotFragments(obj, dirtyComponents.mask(obj), batch);
+        }
+
+        std::unordered_map<ObjectId, std::size_t> ownerIndex;
+        for(std::size_t i = 0; i < batch.size(); i++) ownerIndex[batch[i].id] = i;
+        for(auto &key : dirtySubEntities) {
+            snapshotSubEntity(key, batch, ownerIndex);
+        }
+
         dirty.clear();
+        dirtyComponents.clear();
+        dirtySubEntities.clear();
 
+        submitSnapshots(std::move(batch));
+    }
+
+    void saveAllObjects() {
+        for(auto &&[ent, id] : registry.view<ObjectId>().each()) {
+            dirty.insert(id);
+        }
+        dirtyComponents.clear();
+        processDirty();
+    }
+
+    std::vector<std::function<void(const SaveResult&)>> saveResultFuncs;
+
+    void processSaveResults() {
+        if(!dbWriter) return;
+        for(auto &result : dbWriter->takeResults()) {
+            if(result.error) {
+                logger->error("Save batch {} failed: {}", result.batch, *result.error);
+            }
+            for(auto &func : saveResultFuncs) func(result);
+        }
+    }
+
+    static int64_t getMetaValue(SQLite::Database& conn, const std::string& key) {
+        auto q = prepare(conn, "SELECT value FROM meta WHERE key = ?;");
+        q->bind(1, key);
+        if(q->executeStep()) return q->getColumn(0).getInt64();
+        return 0;
+    }
+
+    void applyStoragePragmas(SQLite::Database& conn) {
+        if(!config::dbJournalMode.empty())
+            conn.exec(fmt::format("PRAGMA journal_mode={};", config::dbJournalMode));
+        if(!config::dbSynchronous.empty())
+            conn.exec(fmt::format("PRAGMA synchronous={};", config::dbSynchronous));
+        conn.exec(fmt::format("PRAGMA cache_size={};", config::dbCacheSize));
+        conn.exec(fmt::format("PRAGMA mmap_size={};", config::dbMmapSize));
+        conn.exec("PRAGMA temp_store=MEMORY;");
+    }
+
+    void upgradeSchema() {
+        // objects.format was added alongside binary encoding. Rows that predate it are JSON text.
+        bool hasFormat = false;
+        SQLite::Statement q(*db, "PRAGMA table_info(objects);");
+        while(q.executeStep()) {
+            if(q.getColumn(1).getString() == "format") hasFormat = true;
+        }
+        if(!hasFormat) {
+            logger->info("Upgrading objects table: adding format column...");
+            db->exec("ALTER TABLE objects ADD COLUMN format INTEGER NOT NULL DEFAULT 0;");
+        }
+
+        // objects.location and isZone were added for zone loading. Until loadObjects() has filled
+        // them in, every zone must be loaded eagerly.
+        bool hasLocation = false;
+        q.reset();
+        while(q.executeStep()) {
+            if(q.getColumn(1).getString() == "location") hasLocation = true;
+        }
+        if(!hasLocation) {
+            logger->info("Upgrading objects table: adding location columns...");
+            db->exec("ALTER TABLE objects ADD COLUMN location INTEGER;");
+            db->exec("ALTER TABLE objects ADD COLUMN isZone INTEGER NOT NULL DEFAULT 0;");
+            db->exec("INSERT OR REPLACE INTO meta (key, value) VALUES ('locationsIndexed', 0);");
+        }
+        db->exec("INSERT OR IGNORE INTO meta (key, value) VALUES ('locationsIndexed', 1);");
+        db->exec("CREATE INDEX IF NOT EXISTS objects_location ON objects(location);");
     }
 
     void readyDatabase() {
         db = std::make_unique<SQLite::Database>(config::dbName, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        applyStoragePragmas(*db);
 
         SQLite::Transaction trans(*db);
         for(auto &s : schema) {
             db->exec(s);
         }
+        upgradeSchema();
+
+        trans.commit();
+
+        watchComponents();
+
+        if(!config::dbJournalName.empty()) {
+            journal = std::make_unique<Journal>(config::dbJournalName);
+        }
+
+        dbWriter = std::make_unique<DatabaseWriter>();
+        dbWriter->start();
+    }
+
+    // A row of objects as read from the database, with its fragments, waiting to be parsed.
+    struct PendingObject {
+        int64_t id{0};
+        int64_t generation{0};
+        ObjectFormat format{ObjectFormat::JsonText};
+        std::vector<uint8_t> data;
+        std::vector<std::tuple<std::string, ObjectFormat, std::optional<std::vector<uint8_t>>>> fragments;
+        nlohmann::json parsed;
+    };
+
+    // A row of object_subentities, waiting for its owner to be hydrated.
+    struct PendingSubEntity {
+        int64_t owner{0};
+        SubEntityKind kind{SubEntityKind::Room};
+        std::string key;
+        ObjectFormat format{ObjectFormat::JsonText};
+        std::vector<uint8_t> data;
+        nlohmann::json parsed;
+    };
+
+    // Creates the Room or point of interest described by a row of object_subentities,
+    // replacing one by the same key which was found nested in its owner's json.
+    static void createSubEntity(entt::entity owner, PendingSubEntity& row) {
+        auto &o = registry.get<ObjectId>(owner);
+        auto point = parseSubEntityKey(row.kind, row.key);
+        auto old = findSubEntity({o, row.kind, point});
+        if(registry.valid(old)) registry.destroy(old);
+
+        auto ent = registry.create();
+        switch(row.kind) {
+            case SubEntityKind::Room: {
+                auto id = std::get<RoomId>(point);
+                registry.get_or_emplace<Area>(owner).data[id] = ent;
+                registry.emplace<Room>(ent, o, id);
+                break;
+            }
+            case SubEntityKind::ExpansePoi:
+                registry.get_or_emplace<Expanse>(owner).poi[std::get<GridPoint>(point)] = ent;
+                registry.emplace<PointOfInterest>(ent, o, row.kind, point);
+                break;
+            case SubEntityKind::MapPoi:
+                registry.get_or_emplace<Map>(owner).poi[std::get<GridPoint>(point)] = ent;
+                registry.emplace<PointOfInterest>(ent, o, row.kind, point);
+                break;
+            case SubEntityKind::SpacePoi:
+                registry.get_or_emplace<Space>(owner).poi[std::get<SectorPoint>(point)] = ent;
+                registry.emplace<PointOfInterest>(ent, o, row.kind, point);
+                break;
+        }
+        deserializeEntity(ent, row.parsed);
+    }
+
+    static std::vector<uint8_t> columnBytes(const SQLite::Column& col) {
+        auto begin = static_cast<const uint8_t*>(col.getBlob());
+        return {begin, begin + col.getBytes()};
+    }
+
+    static void parsePending(std::vector<PendingObject>& pending, std::vector<PendingSubEntity>& pendingSubs) {
+        // Nothing here may touch the registry.
+        parallelFor(pending.size(), [&](std::size_t begin, std::size_t end) {
+            for(auto i = begin; i < end; i++) {
+                auto &row = pending[i];
+                row.parsed = decodeObject(row.format, row.data.data(), row.data.size());
+                for(auto &[key, format, bytes] : row.fragments) {
+                    if(bytes) row.parsed[key] = decodeObject(format, bytes->data(), bytes->size());
+                    else row.parsed.erase(key);
+                }
+                row.data = {};
+                row.fragments = {};
+            }
+        }, config::dbLoadThreads);
+        parallelFor(pendingSubs.size(), [&](std::size_t begin, std::size_t end) {
+            for(auto i = begin; i < end; i++) {
+                auto &row = pendingSubs[i];
+                row.parsed = decodeObject(row.format, row.data.data(), row.data.size());
+                row.data = {};
+            }
+        }, config::dbLoadThreads);
+    }
+
+    static void readSubEntityRow(SQLite::Statement& q, PendingSubEntity& row) {
+        row.owner = q.getColumn(0).getInt64();
+        row.kind = static_cast<SubEntityKind>(q.getColumn(1).getInt());
+        row.key = q.getColumn(2).getString();
+        row.format = static_cast<ObjectFormat>(q.getColumn(3).getInt());
+        row.data = columnBytes(q.getColumn(4));
+    }
+
+    // Decides which objects loadObjects() leaves cold: everything whose Location chain leads
+    // to a zone. The zones themselves are always loaded. Maps id to (generation, zone).
+    static std::unordered_map<int64_t, std::pair<int64_t, int64_t>> planColdObjects(std::unordered_set<int64_t>& zones) {
+        std::unordered_map<int64_t, std::pair<int64_t, int64_t>> rows;
+        SQLite::Statement q(*db, "SELECT id, generation, location, isZone FROM objects;");
+        while(q.executeStep()) {
+            auto id = q.getColumn(0).getInt64();
+            auto loc = q.getColumn(2);
+            rows[id] = {q.getColumn(1).getInt64(), loc.isNull() ? -1 : loc.getInt64()};
+            if(q.getColumn(3).getInt()) zones.insert(id);
+        }
+
+        // zoneOf caches the answer for every object visited, so each chain is only walked once.
+        std::unordered_map<int64_t, int64_t> zoneOf;
+        std::vector<int64_t> chain;
+        for(auto &[id, row] : rows) {
+            chain.clear();
+            int64_t cur = id;
+            int64_t zone = -1;
+            while(true) {
+                if(auto known = zoneOf.find(cur); known != zoneOf.end()) {
+                    zone = known->second;
+                    break;
+                }
+                auto found = rows.find(cur);
+                if(found == rows.end() || chain.size() > rows.size()) break;
+                chain.push_back(cur);
+                auto loc = found->second.second;
+                if(loc < 0) break;
+                if(zones.contains(loc)) {
+                    zone = loc;
+                    break;
+                }
+                cur = loc;
+            }
+            for(auto c : chain) zoneOf[c] = zone;
+        }
 
+        std::unordered_map<int64_t, std::pair<int64_t, int64_t>> cold;
+        for(auto &[id, row] : rows) {
+            if(zones.contains(id)) continue;
+            auto zone = zoneOf[id];
+            if(zone >= 0) cold[id] = {row.first, zone};
+        }
+        return cold;
+    }
+
+    // Fills in objects.location and isZone for a database from before they existed.
+    static void indexLocations() {
+        broadcast("Indexing object locations...");
+        SQLite::Transaction trans(*db);
+        SQLite::Statement q(*db, "UPDATE objects SET location = ?, isZone = ? WHERE id = ?;");
+        for(auto &&[ent, id] : registry.view<ObjectId>().each()) {
+            ObjectSnapshot snap;
+            placeSnapshot(snap, ent);
+            bindLocation(q, 1, snap.location);
+            q.bind(2, snap.isZone ? 1 : 0);
+            q.bind(3, static_cast<int64_t>(id.index));
+            q.exec();
+            q.reset();
+        }
+        db->exec("UPDATE meta SET value = 1 WHERE key = 'locationsIndexed';");
         trans.commit();
     }
 
     void loadObjects() {
-        // Step 1: get max id of objects table.
-        SQLite::Statement q(*db, "SELECT MAX(id) FROM objects;");
-        q.executeStep();
-        auto count = q.getColumn(0).getInt64();
+        // With lazy zones, figure out what stays in the database before reading anything big.
+        std::unordered_set<int64_t> zones;
+        std::unordered_map<int64_t, std::pair<int64_t, int64_t>> cold;
+        bool indexed = getMetaValue(*db, "locationsIndexed") != 0;
+        if(config::dbLazyZones && indexed) {
+            cold = planColdObjects(zones);
+        }
 
-        // Reserve RAM for a single easy allocation to make this simple...
-        objects.resize(count + 50, {0, entt::null});
+        // Step 1: read every row in a single pass. The raw bytes are kept for the parsers.
+        std::vector<PendingObject> pending;
+        std::unordered_map<int64_t, std::size_t> rowIndex;
+        int64_t maxId = -1;
 
-        std::size_t counter = 0;
-        broadcast("Preparing objects for loading...");
-        SQLite::Statement q1(*db, "SELECT id, generation FROM objects;");
+        broadcast("Reading objects...");
+        SQLite::Statement q1(*db, "SELECT id, generation, format, data FROM objects ORDER BY id;");
         while(q1.executeStep()) {
             auto id = q1.getColumn(0).getInt64();
-            auto gen = q1.getColumn(1).getInt64();
+            maxId = std::max(maxId, id);
+            if(cold.contains(id)) continue;
+            auto &row = pending.emplace_back();
+            row.id = id;
+            row.generation = q1.getColumn(1).getInt64();
+            row.format = static_cast<ObjectFormat>(q1.getColumn(2).getInt());
+            row.data = columnBytes(q1.getColumn(3));
+            rowIndex[row.id] = pending.size() - 1;
+        }
+
+        // Any component fragments saved since their objects were last written in full.
+        SQLite::Statement qf(*db, "SELECT id, component, format, data FROM object_components;");
+        while(qf.executeStep()) {
+            auto found = rowIndex.find(qf.getColumn(0).getInt64());
+            if(found == rowIndex.end()) continue;
+            auto data = qf.getColumn(3);
+            std::optional<std::vector<uint8_t>> bytes;
+            if(!data.isNull()) bytes = columnBytes(data);
+            pending[found->second].fragments.emplace_back(qf.getColumn(1).getString(),
+                    static_cast<ObjectFormat>(qf.getColumn(2).getInt()), std::move(bytes));
+        }
+
+        // A cold zone's rooms and points of interest wait for it to be hydrated.
+        std::vector<PendingSubEntity> pendingSubs;
+        SQLite::Statement qs(*db, "SELECT owner, kind, key, format, data FROM object_subentities;");
+        while(qs.executeStep()) {
+            if(zones.contains(qs.getColumn(0).getInt64())) continue;
+            readSubEntityRow(qs, pendingSubs.emplace_back());
+        }
+        broadcast(fmt::format("Read {} objects and {} rooms/points of interest.", pending.size(), pendingSubs.size()));
+
+        // Step 2: parse on the worker pool.
+        broadcast("Parsing objects...");
+        parsePending(pending, pendingSubs);
+
+        // Step 3: apply to the registry, single-threaded and in id order. Every entity must
+        // exist before any is hydrated, so that relationships can be resolved.
+        // Reserve RAM for a single easy allocation to make this simple...
+        objects.resize(maxId + 50, {0, entt::null});
+
+        broadcast("Preparing objects for loading...");
+        for(auto &row : pending) {
             auto ent = registry.create();
-            registry.emplace<ObjectId>(ent, id, gen);
-            objects[id] = {gen, ent};
-            counter++;
+            registry.emplace<ObjectId>(ent, row.id, row.generation);
+            objects[row.id] = {row.generation, ent};
         }
-        broadcast(fmt::format("Prepared {} objects.", counter));
+        // Cold objects must hold their slots before anything is hydrated, so that references
+        // to them are recognized.
+        for(auto &[id, row] : cold) {
+            setObjectCold(id, row.first, ObjectId(row.second, objects[row.second].first));
+        }
+        for(auto id : zones) {
+            auto ent = objects[id].second;
+            if(registry.valid(ent)) registry.emplace_or_replace<ColdZone>(ent);
+        }
+        broadcast(fmt::format("Prepared {} objects, {} left cold.", pending.size(), cold.size()));
 
         std::size_t hydrated = 0;
         broadcast("Hydrating objects...");
-        // Now we're gonna need to select id and data from objects to deserialize.
-        SQLite::Statement q2(*db, "SELECT id, data FROM objects;");
-        while(q2.executeStep()) {
-            auto id = q2.getColumn(0).getInt64();
-            auto data = q2.getColumn(1).getText();
-            auto ent = objects[id].second;
-            deserializeEntity(ent, nlohmann::json::parse(data));
-            hydrated++;
-            if(hydrated % 100 == 0) {
-                broadcast(fmt::format("Hydrated {}/{} objects.", hydrated, counter));
+        // Everything is labelled at once below, rather than one setLocation() at a time.
+        FlagGuard deferGuard(deferContainment, true);
+        {
+            FlagGuard guard(migrateNestedSubEntities, true);
+            for(auto &row : pending) {
+                deserializeEntity(objects[row.id].second, row.parsed);
+                row.parsed = {};
+                hydrated++;
+                if(hydrated % 1000 == 0) {
+                    broadcast(fmt::format("Hydrated {}/{} objects.", hydrated, pending.size()));
+                }
             }
         }
         broadcast(fmt::format("Hydrated {} objects.", hydrated));
 
+        // Rooms and points of interest go last, as their owners must exist first.
+        std::size_t subs = 0;
+        for(auto &row : pendingSubs) {
+            if(row.owner < 0 || row.owner >= static_cast<int64_t>(objects.size())) continue;
+            auto owner = objects[row.owner].second;
+            if(!registry.valid(owner)) continue;
+            createSubEntity(owner, row);
+            row.parsed = {};
+            subs++;
+        }
+        broadcast(fmt::format("Hydrated {} rooms/points of interest.", subs));
+        rebuildContainment();
+
+        // Everything is loaded this time, so this is the chance to catch the index up.
+        if(!indexed) indexLocations();
+    }
+
+    std::size_t loadZoneContents(entt::entity zone) {
+        auto zoneIndex = registry.get<ObjectId>(zone).index;
+        std::vector<std::size_t> ids;
+        if(auto found = coldZoneContents.find(zoneIndex); found != coldZoneContents.end()) {
+            ids = std::move(found->second);
+            coldZoneContents.erase(found);
+        }
+
+        std::vector<PendingObject> pending;
+        pending.reserve(ids.size());
+        auto q1 = prepare(*db, "SELECT generation, format, data FROM objects WHERE id = ?;");
+        auto qf = prepare(*db, "SELECT component, format, data FROM object_components WHERE id = ?;");
+        for(auto id : ids) {
+            coldObjects.erase(id);
+            q1->bind(1, static_cast<int64_t>(id));
+            if(q1->executeStep()) {
+                auto &row = pending.emplace_back();
+                row.id = static_cast<int64_t>(id);
+                row.generation = q1->getColumn(0).getInt64();
+                row.format = static_cast<ObjectFormat>(q1->getColumn(1).getInt());
+                row.data = columnBytes(q1->getColumn(2));
+                qf->bind(1, row.id);
+                while(qf->executeStep()) {
+                    auto data = qf->getColumn(2);
+                    std::optional<std::vector<uint8_t>> bytes;
+                    if(!data.isNull()) bytes = columnBytes(data);
+                    row.fragments.emplace_back(qf->getColumn(0).getString(),
+                            static_cast<ObjectFormat>(qf->getColumn(1).getInt()), std::move(bytes));
+                }
+                qf->reset();
+            } else {
+                // It was deleted out from under us; free up the slot.
+                objects[id] = {0, entt::null};
+            }
+            q1->reset();
+        }
+
+        std::vector<PendingSubEntity> pendingSubs;
+        auto qs = prepare(*db, "SELECT owner, kind, key, format, data FROM object_subentities WHERE owner = ?;");
+        qs->bind(1, static_cast<int64_t>(zoneIndex));
+        while(qs->executeStep()) {
+            readSubEntityRow(*qs, pendingSubs.emplace_back());
+        }
+
+        parsePending(pending, pendingSubs);
+
+        // As in loadObjects(), none of this is a change that needs saving.
+        FlagGuard guard(gameIsLoading, true);
+        FlagGuard deferGuard(deferContainment, true);
+        std::sort(pending.begin(), pending.end(), [](auto &a, auto &b) { return a.id < b.id; });
+        std::vector<entt::entity> loaded;
+        loaded.reserve(pending.size());
+        for(auto &row : pending) {
+            auto ent = registry.create();
+            registry.emplace<ObjectId>(ent, row.id, row.generation);
+            objects[row.id] = {row.generation, ent};
+            loaded.push_back(ent);
+        }
+        for(auto &row : pending) {
+            deserializeEntity(objects[row.id].second, row.parsed);
+        }
+        for(auto &row : pendingSubs) {
+            createSubEntity(zone, row);
+        }
+        rebuildContainment(loaded);
+        return pending.size();
+    }
+
+    std::size_t migrateObjects(ObjectFormat format) {
+        std::size_t converted = 0;
+        auto chunkSize = std::max<std::size_t>(config::dbSaveChunkSize, 1);
+
+        SQLite::Statement q1(*db, "SELECT id, format, data FROM objects WHERE format != ? AND id > ? ORDER BY id LIMIT ?;");
+        SQLite::Statement q2(*db, "UPDATE objects SET format = ?, data = ? WHERE id = ?;");
+
+        // Walk the table in id order, one transaction per chunk, so that a huge
+        // database doesn't need to fit in a single transaction.
+        int64_t lastId = -1;
+        while(true) {
+            std::vector<std::pair<int64_t, std::vector<uint8_t>>> chunk;
+            q1.bind(1, static_cast<int>(format));
+            q1.bind(2, lastId);
+            q1.bind(3, static_cast<int64_t>(chunkSize));
+            while(q1.executeStep()) {
+                auto id = q1.getColumn(0).getInt64();
+                auto oldFormat = static_cast<ObjectFormat>(q1.getColumn(1).getInt());
+                auto data = q1.getColumn(2);
+                chunk.emplace_back(id, encodeObject(decodeObject(oldFormat, data.getBlob(), data.getBytes()), format));
+            }
+            q1.reset();
+            if(chunk.empty()) break;
+
+            SQLite::Transaction trans(*db);
+            db->exec("UPDATE meta SET value = value + 1 WHERE key = 'epoch';");
+            for(auto &[id, encoded] : chunk) {
+                q2.bind(1, static_cast<int>(format));
+                q2.bind(2, encoded.data(), static_cast<int>(encoded.size()));
+                q2.bind(3, id);
+                q2.exec();
+                q2.reset();
+            }
+            trans.commit();
+            converted += chunk.size();
+            lastId = chunk.back().first;
+            logger->info("Migrated {} objects...", converted);
+        }
+
+        return converted;
+    }
+
+    int64_t getSaveEpoch(SQLite::Database& conn) {
+        return getMetaValue(conn, "epoch");
     }
 
     std::vector<std::function<void()>> preLoadFuncs, postLoadFuncs;
@@ -421,27 +1477,22 @@ namespace core {
     void loadDatabase() {
         broadcast("Loading game database... please wait warmly...");
         for(auto &func : preLoadFuncs) func();
-        loadObjects();
+        // Anything a previous run journaled but never compacted is newer than the tables.
+        recoverJournal();
+        bool loaded = false;
+        // A snapshot loads every zone, which defeats the point of lazy zones.
+        if(!config::dbSnapshotName.empty() && !config::dbLazyZones) {
+            auto [res, err] = loadSnapshot(config::dbSnapshotName);
+            if(res) loaded = true;
+            else logger->info("Not using snapshot: {}", err.value_or("unknown reason"));
+        }
+        if(!loaded) loadObjects();
+        resetFreeObjectIds();
+        noteObjectGeneration(getMetaValue(*db, "generation"));
+        for(auto &[gen, ent] : objects) noteObjectGeneration(gen);
         broadcast("Loaded Objects.");
+        loadAccounts();
         for(auto &func : postLoadFuncs) func();
     }
 
-    void savePrototype(const std::string& name, const nlohmann::json& j) {
-        SQLite::Statement q(*db, "INSERT OR REPLACE INTO prototypes (name, data) VALUES (?, ?) ON CONFLICT(name) DO UPDATE set data=VALUES(data)");
-        q.bind(1, name);
-        q.bind(2, j.dump(4, ' ', false, nlohmann::json::error_handler_t::ignore));
-        q.exec();
-        q.reset();
-    }
-
-    std::optional<nlohmann::json> getPrototype(const std::string& name) {
-        SQLite::Statement q(*db, "SELECT data FROM prototypes WHERE name = ?;");
-        q.bind(1, name);
-        if(q.executeStep()) {
-            auto data = q.getColumn(0).getText();
-            return nlohmann::json::parse(data);
-        }
-        return std::nullopt;
-    }
-
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "core/core.h"
 #include "core/link.h"
 #include "core/database.h"
+#include "core/snapshot.h"
+#include "core/journal.h"
 
 namespace core {
     std::vector<std::function<async<void>()>> gameStartupFuncs;
@@ -109,6 +111,18 @@ namespace core {
 
     async<void> defaultGameShutdown() {
         logger->info("Shutting down...");
+        // Everything still dirty must reach the disk before the writer goes away.
+        // Writing the snapshot takes care of that, too.
+        if(!config::dbSnapshotName.empty()) {
+            auto [res, err] = writeSnapshot(config::dbSnapshotName);
+            if(!res) logger->error("Could not write snapshot: {}", err.value_or("unknown reason"));
+        }
+        checkpointDatabase();
+        if(dbWriter) {
+            logger->info("Waiting for database writer to finish...");
+            dbWriter->stop();
+        }
+        processSaveResults();
         co_return;
     }
     std::function<async<void>()> gameShutdown(defaultGameShutdown);
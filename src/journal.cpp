@@ -0,0 +1,311 @@
+#include "core/journal.h"
+#include "core/config.h"
+#include "core/link.h"
+#include "core/accounts.h"
+#include "core/api.h"
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace core {
+
+    std::unique_ptr<Journal> journal;
+
+    static nlohmann::json snapshotToJson(const ObjectSnapshot& snap) {
+        nlohmann::json j;
+        j["id"] = snap.id;
+        if(snap.data) j["data"] = *snap.data;
+        if(snap.location >= 0) j["location"] = snap.location;
+        if(snap.isZone) j["isZone"] = true;
+        if(!snap.components.empty()) {
+            auto &comps = j["components"];
+            for(auto &[key, value] : snap.components) {
+                comps.push_back({key, value ? *value : nlohmann::json()});
+            }
+        }
+        if(!snap.subEntities.empty()) {
+            auto &subs = j["sub"];
+            for(auto &[kind, key, value] : snap.subEntities) {
+                subs.push_back({static_cast<int>(kind), key, value ? *value : nlohmann::json()});
+            }
+        }
+        return j;
+    }
+
+    static ObjectSnapshot snapshotFromJson(const nlohmann::json& j) {
+        ObjectSnapshot snap;
+        snap.id = ObjectId(j["id"]);
+        if(j.contains("data")) snap.data = j["data"];
+        if(j.contains("location")) snap.location = j["location"];
+        if(j.contains("isZone")) snap.isZone = j["isZone"];
+        if(j.contains("components")) {
+            for(auto &c : j["components"]) {
+                std::optional<nlohmann::json> value;
+                if(!c[1].is_null()) value = c[1];
+                snap.components.emplace_back(c[0].get<std::string>(), std::move(value));
+            }
+        }
+        if(j.contains("sub")) {
+            for(auto &c : j["sub"]) {
+                std::optional<nlohmann::json> value;
+                if(!c[2].is_null()) value = c[2];
+                snap.subEntities.emplace_back(static_cast<SubEntityKind>(c[0].get<int>()), c[1].get<std::string>(), std::move(value));
+            }
+        }
+        return snap;
+    }
+
+    Journal::Journal(std::string path) : path(std::move(path)) {}
+
+    Journal::~Journal() {
+        if(fd != -1) ::close(fd);
+    }
+
+    void Journal::open() {
+        if(fd != -1) return;
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if(fd == -1) throw std::runtime_error(fmt::format("Could not open journal {}: {}", path, std::strerror(errno)));
+        struct stat st{};
+        if(::fstat(fd, &st) == 0) bytes = st.st_size;
+    }
+
+    void Journal::append(const std::vector<ObjectSnapshot>& batch) {
+        open();
+        std::vector<uint8_t> buffer;
+        for(auto &snap : batch) {
+            auto payload = nlohmann::json::to_msgpack(snapshotToJson(snap));
+            uint32_t length = payload.size();
+            uint64_t sum = checksum64(payload.data(), payload.size());
+            auto p = reinterpret_cast<const uint8_t*>(&length);
+            buffer.insert(buffer.end(), p, p + sizeof(length));
+            p = reinterpret_cast<const uint8_t*>(&sum);
+            buffer.insert(buffer.end(), p, p + sizeof(sum));
+            buffer.insert(buffer.end(), payload.begin(), payload.end());
+        }
+
+        std::size_t written = 0;
+        while(written < buffer.size()) {
+            auto res = ::write(fd, buffer.data() + written, buffer.size() - written);
+            if(res < 0) {
+                if(errno == EINTR) continue;
+                throw std::runtime_error(fmt::format("Could not write journal {}: {}", path, std::strerror(errno)));
+            }
+            written += res;
+        }
+        bytes += written;
+    }
+
+    void Journal::sync() {
+        if(fd == -1) return;
+        if(::fsync(fd) != 0) throw std::runtime_error(fmt::format("Could not sync journal {}: {}", path, std::strerror(errno)));
+    }
+
+    void Journal::truncate() {
+        open();
+        if(::ftruncate(fd, 0) != 0) throw std::runtime_error(fmt::format("Could not truncate journal {}: {}", path, std::strerror(errno)));
+        sync();
+        bytes = 0;
+    }
+
+    std::vector<ObjectSnapshot> Journal::read(const std::string& path) {
+        std::vector<ObjectSnapshot> out;
+        std::ifstream in(path, std::ios::binary);
+        if(!in) return out;
+        in.seekg(0, std::ios::end);
+        auto fileSize = static_cast<uint64_t>(in.tellg());
+        in.seekg(0, std::ios::beg);
+        std::vector<uint8_t> payload;
+        while(true) {
+            uint32_t length;
+            uint64_t sum;
+            if(!in.read(reinterpret_cast<char*>(&length), sizeof(length))) break;
+            if(!in.read(reinterpret_cast<char*>(&sum), sizeof(sum))) break;
+            // A torn or corrupt header can claim more than is left; that's the end of the journal.
+            auto left = fileSize - static_cast<uint64_t>(in.tellg());
+            if(length > left) {
+                logger->warn("Journal {}: record claims {} bytes but only {} remain after {} records; ignoring the rest.", path, length, left, out.size());
+                break;
+            }
+            payload.resize(length);
+            if(!in.read(reinterpret_cast<char*>(payload.data()), length)) break;
+            if(checksum64(payload.data(), payload.size()) != sum) {
+                logger->warn("Journal {}: checksum mismatch after {} records; ignoring the rest.", path, out.size());
+                break;
+            }
+            out.push_back(snapshotFromJson(nlohmann::json::from_msgpack(payload)));
+        }
+        return out;
+    }
+
+    void SnapshotCoalescer::add(ObjectSnapshot snap) {
+        auto found = index.find(snap.id);
+        if(found == index.end()) {
+            index.emplace(snap.id, order.size());
+            order.push_back(std::move(snap));
+            return;
+        }
+        auto &existing = order[found->second];
+        // A deletion supersedes everything before it, and anything after one starts afresh.
+        if(snap.isDeletion() || existing.isDeletion()) {
+            existing = std::move(snap);
+            return;
+        }
+        existing.location = snap.location;
+        existing.isZone = snap.isZone;
+        // Rooms and points of interest are rows of their own, so even a full save keeps them.
+        for(auto &[kind, key, value] : snap.subEntities) {
+            auto same = std::find_if(existing.subEntities.begin(), existing.subEntities.end(), [&](auto &c) {
+                return std::get<0>(c) == kind && std::get<1>(c) == key;
+            });
+            if(same != existing.subEntities.end()) std::get<2>(*same) = std::move(value);
+            else existing.subEntities.emplace_back(kind, std::move(key), std::move(value));
+        }
+        if(snap.data) {
+            existing.data = std::move(snap.data);
+            existing.components.clear();
+            return;
+        }
+        for(auto &[key, value] : snap.components) {
+            if(existing.data) {
+                if(value) (*existing.data)[key] = std::move(*value);
+                else existing.data->erase(key);
+                continue;
+            }
+            auto same = std::find_if(existing.components.begin(), existing.components.end(), [&](auto &c) { return c.first == key; });
+            if(same != existing.components.end()) same->second = std::move(value);
+            else existing.components.emplace_back(key, std::move(value));
+        }
+    }
+
+    std::vector<ObjectSnapshot> SnapshotCoalescer::take() {
+        std::vector<ObjectSnapshot> out;
+        out.swap(order);
+        index.clear();
+        return out;
+    }
+
+    // Everything below is shared between the game strand and the writer thread.
+    static std::mutex journalMutex;
+    static std::vector<std::pair<uint64_t, std::vector<ObjectSnapshot>>> journalQueue;
+    static bool journalJobScheduled{false};
+    // Writer thread only.
+    static SnapshotCoalescer uncompacted;
+    static auto lastCompaction = std::chrono::steady_clock::now();
+
+    static void runJournalJob(SQLite::Database& conn) {
+        std::vector<std::pair<uint64_t, std::vector<ObjectSnapshot>>> queued;
+        {
+            std::lock_guard<std::mutex> lock(journalMutex);
+            queued.swap(journalQueue);
+            journalJobScheduled = false;
+        }
+        if(queued.empty()) return;
+
+        auto started = std::chrono::steady_clock::now();
+        std::optional<std::string> error;
+        try {
+            for(auto &[batchId, batch] : queued) journal->append(batch);
+            journal->sync();
+        } catch(std::exception& e) {
+            error = e.what();
+        }
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        for(auto &[batchId, batch] : queued) {
+            SaveResult result;
+            result.batch = batchId;
+            result.seconds = seconds;
+            result.error = error;
+            for(auto &snap : batch) {
+                if(snap.isDeletion()) result.deleted++;
+                else if(snap.data) result.saved++;
+                else if(!snap.components.empty()) result.fragments++;
+                result.subEntities += snap.subEntities.size();
+            }
+            dbWriter->reportResult(std::move(result));
+            if(error) {
+                // The journal can't be trusted, so write these straight to the table instead.
+                auto direct = writeSnapshots(conn, batch);
+                if(direct.error) logger->error("Fallback write of batch {} failed: {}", batchId, *direct.error);
+                continue;
+            }
+            for(auto &snap : batch) uncompacted.add(std::move(snap));
+        }
+
+        if(journal->size() >= config::dbJournalCompactBytes
+            || std::chrono::steady_clock::now() - lastCompaction >= config::dbJournalCompactInterval) {
+            compactJournal(conn);
+        }
+    }
+
+    void submitToJournal(std::vector<ObjectSnapshot> batch, uint64_t batchId) {
+        bool schedule = false;
+        {
+            std::lock_guard<std::mutex> lock(journalMutex);
+            journalQueue.emplace_back(batchId, std::move(batch));
+            if(!journalJobScheduled) {
+                journalJobScheduled = true;
+                schedule = true;
+            }
+        }
+        if(schedule) dbWriter->submit(runJournalJob);
+    }
+
+    void compactJournal(SQLite::Database& conn) {
+        lastCompaction = std::chrono::steady_clock::now();
+        if(uncompacted.empty()) return;
+        auto batch = uncompacted.take();
+        auto result = writeSnapshots(conn, batch);
+        if(result.error) {
+            // Keep the journal; everything in it will be tried again next time.
+            logger->error("Journal compaction failed: {}", *result.error);
+            for(auto &snap : batch) uncompacted.add(std::move(snap));
+            return;
+        }
+        // The table must be on disk before the journal which covers it is thrown away.
+        conn.exec("PRAGMA wal_checkpoint(FULL);");
+        journal->truncate();
+        logger->info("Compacted journal: {} objects, {} fragments, {} deletions in {:.3f} seconds.",
+                     result.saved, result.fragments, result.deleted, result.seconds);
+    }
+
+    std::size_t recoverJournal() {
+        if(config::dbJournalName.empty()) return 0;
+        auto batch = Journal::read(config::dbJournalName);
+        if(batch.empty()) return 0;
+
+        broadcast(fmt::format("Replaying {} journaled saves...", batch.size()));
+        SnapshotCoalescer coalescer;
+        for(auto &snap : batch) coalescer.add(std::move(snap));
+        auto folded = coalescer.take();
+        auto result = writeSnapshots(*db, folded);
+        if(result.error) throw std::runtime_error(fmt::format("Could not replay journal: {}", *result.error));
+        db->exec("PRAGMA wal_checkpoint(FULL);");
+        Journal(config::dbJournalName).truncate();
+        return batch.size();
+    }
+
+    void checkpointDatabase() {
+        // Deletions still queued would otherwise be saved as if they'd survived.
+        processDeletions();
+        flushAccountUpdates();
+        processDirty();
+        if(!dbWriter || !dbWriter->isRunning()) return;
+        if(journal) dbWriter->submit(compactJournal);
+        dbWriter->flush();
+    }
+
+    void awaitWriter() {
+        if(!dbWriter || !dbWriter->isRunning()) return;
+        if(journal) dbWriter->submit(compactJournal);
+        // Jobs run in order, so once this one has, everything before it has too.
+        std::promise<void> fence;
+        auto done = fence.get_future();
+        dbWriter->submit([&fence](SQLite::Database&) { fence.set_value(); });
+        done.wait();
+    }
+
+}
@@ -0,0 +1,259 @@
+#include "core/ndjson.h"
+#include "core/config.h"
+#include "core/zone.h"
+#include "core/api.h"
+#include "core/containment.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace core {
+
+    std::vector<std::function<void(nlohmann::json&, const ObjectIdRemap&)>> importRemapFuncs;
+
+    void remapObjectIdJson(nlohmann::json& j, const ObjectIdRemap& remap) {
+        if(!j.is_array() || j.size() != 2) return;
+        ObjectId id(j);
+        if(auto found = remap.find(id); found != remap.end()) j = found->second;
+    }
+
+    static std::size_t transferChunkSize() {
+        return config::dbTransferChunkSize ? config::dbTransferChunkSize : 1;
+    }
+
+    OpResult<std::size_t> exportObjects(const std::string& path, const std::vector<entt::entity>& ents) {
+        auto tmp = path + ".tmp";
+        std::size_t written = 0;
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if(!out) return {0, fmt::format("Could not open {} for writing", tmp)};
+
+            std::vector<entt::entity> chunk;
+            std::vector<std::string> lines;
+            for(std::size_t start = 0; start < ents.size(); start += transferChunkSize()) {
+                auto end = std::min(ents.size(), start + transferChunkSize());
+                chunk.clear();
+                for(auto i = start; i < end; i++) {
+                    if(registry.valid(ents[i]) && registry.all_of<ObjectId>(ents[i])) chunk.push_back(ents[i]);
+                }
+                // Gathering the json needs the registry, so it stays here. Dumping it doesn't.
+                auto data = serializeEntities(chunk, false, true);
+                std::vector<ObjectId> ids;
+                ids.reserve(chunk.size());
+                for(auto ent : chunk) ids.push_back(registry.get<ObjectId>(ent));
+
+                lines.assign(chunk.size(), {});
+                parallelFor(chunk.size(), [&](std::size_t begin, std::size_t finish) {
+                    for(auto i = begin; i < finish; i++) {
+                        // Written by hand so that id comes first; importObjects() reads it without parsing the rest.
+                        lines[i] = fmt::format("{{\"id\":[{},{}],\"data\":{}}}\n", ids[i].index, ids[i].generation,
+                                               data[i].dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+                        data[i] = {};
+                    }
+                }, config::dbLoadThreads);
+                for(auto &line : lines) out.write(line.data(), static_cast<std::streamsize>(line.size()));
+                if(!out) return {0, fmt::format("Could not write {}", tmp)};
+                written += chunk.size();
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        if(ec) return {0, fmt::format("Could not rename {} to {}: {}", tmp, path, ec.message())};
+        return {written, std::nullopt};
+    }
+
+    OpResult<std::size_t> exportZone(const std::string& path, entt::entity zone) {
+        if(!isZone(zone)) return {0, "That is not a zone."};
+        std::vector<entt::entity> ents{zone};
+        std::unordered_set<entt::entity> seen{zone};
+        for(std::size_t i = 0; i < ents.size(); i++) {
+            ensureHydrated(ents[i]);
+            for(auto c : viewContents(ents[i])) {
+                if(seen.insert(c).second) ents.push_back(c);
+            }
+        }
+        return exportObjects(path, ents);
+    }
+
+    OpResult<std::size_t> exportWorld(const std::string& path) {
+        std::vector<entt::entity> zones;
+        for(auto ent : registry.view<ColdZone>()) zones.push_back(ent);
+        for(auto zone : zones) hydrateZone(zone);
+
+        std::vector<entt::entity> ents;
+        ents.reserve(objects.size());
+        for(auto &[gen, ent] : objects) {
+            if(registry.valid(ent)) ents.push_back(ent);
+        }
+        return exportObjects(path, ents);
+    }
+
+    // The id at the front of a line written by exportObjects(), or the hard way for anything else.
+    static std::optional<ObjectId> readLineId(const std::string& line) {
+        std::size_t index;
+        long long generation;
+        if(std::sscanf(line.c_str(), "{\"id\":[%zu,%lld]", &index, &generation) == 2) {
+            return ObjectId(index, generation);
+        }
+        auto j = nlohmann::json::parse(line, nullptr, false);
+        if(j.is_discarded() || !j.contains("id")) return std::nullopt;
+        return ObjectId(j["id"]);
+    }
+
+    static void remapEntityJson(nlohmann::json& j, const ObjectIdRemap& remap) {
+        for(auto key : {"Location", "Parent", "Owner"}) {
+            if(auto found = j.find(key); found != j.end()) remapObjectIdJson(*found, remap);
+        }
+        if(auto room = j.find("Room"); room != j.end() && room->contains("obj")) {
+            remapObjectIdJson((*room)["obj"], remap);
+        }
+        for(auto &func : importRemapFuncs) func(j, remap);
+    }
+
+    static void remapObjectJson(nlohmann::json& j, const ObjectIdRemap& remap) {
+        remapEntityJson(j, remap);
+        if(auto area = j.find("Area"); area != j.end() && area->is_array()) {
+            for(auto &room : *area) {
+                if(room.is_array() && room.size() == 2) remapEntityJson(room[1], remap);
+            }
+        }
+        for(auto key : {"Expanse", "Map", "Space"}) {
+            auto grid = j.find(key);
+            if(grid == j.end() || !grid->contains("poi")) continue;
+            for(auto &poi : (*grid)["poi"]) {
+                if(poi.is_array() && poi.size() == 2) remapEntityJson(poi[1], remap);
+            }
+        }
+    }
+
+    // Imported objects hold their Rooms and points of interest nested, which need rows of their own.
+    static void markSubEntitiesDirty(entt::entity ent) {
+        if(auto area = registry.try_get<Area>(ent)) {
+            for(auto &[id, room] : area->data) setSubEntityDirty(room, true);
+        }
+        if(auto grid = registry.try_get<Expanse>(ent)) {
+            for(auto &[point, poi] : grid->poi) setSubEntityDirty(poi, true);
+        }
+        if(auto grid = registry.try_get<Map>(ent)) {
+            for(auto &[point, poi] : grid->poi) setSubEntityDirty(poi, true);
+        }
+        if(auto grid = registry.try_get<Space>(ent)) {
+            for(auto &[point, poi] : grid->poi) setSubEntityDirty(poi, true);
+        }
+    }
+
+    OpResult<std::size_t> importObjects(const std::string& path, bool remap) {
+        // Pass 1: only the ids, so that every object exists before any is hydrated and references
+        // to objects further along in the file resolve.
+        std::vector<ObjectId> ids;
+        {
+            std::ifstream in(path, std::ios::binary);
+            if(!in) return {0, fmt::format("Could not open {}", path)};
+            std::string line;
+            std::size_t lineNo = 0;
+            while(std::getline(in, line)) {
+                lineNo++;
+                if(line.empty()) continue;
+                auto id = readLineId(line);
+                if(!id) return {0, fmt::format("{} line {}: no object id", path, lineNo)};
+                ids.push_back(*id);
+            }
+        }
+        if(ids.empty()) return {0, std::nullopt};
+
+        ObjectIdRemap mapping;
+        std::vector<entt::entity> ents;
+        if(remap) {
+            ents = createObjects(ids.size());
+            mapping.reserve(ids.size());
+            for(std::size_t i = 0; i < ids.size(); i++) mapping[ids[i]] = registry.get<ObjectId>(ents[i]);
+        } else {
+            std::unordered_set<std::size_t> indexes;
+            for(auto &id : ids) {
+                if(!indexes.insert(id.index).second) return {0, fmt::format("Object {} appears more than once.", id.toString())};
+                if(id.index < objects.size() && (registry.valid(objects[id.index].second) || isObjectCold(id.index))) {
+                    return {0, fmt::format("Object {} is already in use.", id.toString())};
+                }
+            }
+            ents.reserve(ids.size());
+            for(auto &id : ids) {
+                if(id.index >= objects.size()) objects.resize(id.index + 40, {0, entt::null});
+                auto ent = registry.create();
+                registry.emplace<ObjectId>(ent, id);
+                objects[id.index] = {id.generation, ent};
+                noteObjectGeneration(id.generation);
+                ents.push_back(ent);
+            }
+        }
+
+        // Undoes the whole import: everything created above is deleted, hydrated or not, which
+        // takes it back out of whatever existing objects it was put in and frees its slot.
+        auto rollback = [&]() {
+            // Anything already queued this tick waits for ProcessDeletions as usual.
+            auto queued = std::move(pendingDeletions);
+            pendingDeletions.clear();
+            for(auto ent : ents) deleteObject(ent);
+            processDeletions();
+            pendingDeletions = std::move(queued);
+        };
+
+        // Pass 2: parse a chunk at a time on the worker pool, then hydrate in file order.
+        std::ifstream in(path, std::ios::binary);
+        if(!in) {
+            rollback();
+            return {0, fmt::format("Could not reopen {}", path)};
+        }
+        std::vector<std::string> lines;
+        std::vector<nlohmann::json> parsed;
+        std::size_t next = 0;
+        std::string line;
+        std::optional<std::string> failure;
+        {
+            // Each object is saved whole once it's hydrated; the changes along the way don't matter.
+            FlagGuard guard(gameIsLoading, true);
+            // Everything imported is labelled at once at the end, rather than one setLocation() at a time.
+            FlagGuard deferGuard(deferContainment, true);
+            try {
+                while(next < ents.size()) {
+                    lines.clear();
+                    while(lines.size() < transferChunkSize() && std::getline(in, line)) {
+                        if(!line.empty()) lines.push_back(std::move(line));
+                    }
+                    if(lines.empty()) break;
+
+                    parsed.assign(lines.size(), {});
+                    parallelFor(lines.size(), [&](std::size_t begin, std::size_t end) {
+                        for(auto i = begin; i < end; i++) {
+                            auto j = nlohmann::json::parse(lines[i]);
+                            lines[i] = {};
+                            parsed[i] = std::move(j["data"]);
+                            if(remap) remapObjectJson(parsed[i], mapping);
+                        }
+                    }, config::dbLoadThreads);
+
+                    for(auto &data : parsed) {
+                        if(next == ents.size()) throw std::runtime_error("the file has grown since it was read");
+                        auto ent = ents[next++];
+                        deserializeEntity(ent, data);
+                        data = {};
+                        setDirty(ent, true);
+                        markSubEntitiesDirty(ent);
+                    }
+                }
+                // The file changed since the first pass and has fewer objects in it now.
+                if(next < ents.size()) failure = "the file ended early";
+            } catch(std::exception& e) {
+                failure = e.what();
+            }
+        }
+        // Undone with the guards released, so that the holders they were put in are saved again.
+        if(failure) {
+            rollback();
+            return {0, fmt::format("{} after {} objects: {}. Nothing was imported.", path, next, *failure)};
+        }
+        rebuildContainment(ents);
+        logger->info("Imported {} objects from {}.", next, path);
+        return {next, std::nullopt};
+    }
+
+}
@@ -0,0 +1,98 @@
+#include "core/prototype.h"
+
+namespace core {
+
+    // Keyed by the name folded to lowercase, like the name column's COLLATE NOCASE. A nullptr
+    // remembers that there's no such prototype.
+    static std::unordered_map<std::string, std::shared_ptr<const CompiledPrototype>>& prototypeCache() {
+        // Function-local, since serializers may be registered during static initialization.
+        static std::unordered_map<std::string, std::shared_ptr<const CompiledPrototype>> cache;
+        return cache;
+    }
+
+    static std::string foldPrototypeName(std::string_view name) {
+        std::string out(name);
+        for(auto &c : out) {
+            if(c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        return out;
+    }
+
+    static std::shared_ptr<const CompiledPrototype> compilePrototype(const std::string& name, nlohmann::json data) {
+        auto out = std::make_shared<CompiledPrototype>();
+        out->name = name;
+        out->data = std::move(data);
+
+        // Decoding onto scratch entities isn't a change that needs saving.
+        FlagGuard guard(gameIsLoading, true);
+        for(auto &serializer : componentSerializers) {
+            auto found = out->data.find(serializer.key);
+            if(found == out->data.end()) continue;
+            if(serializer.compile) {
+                if(auto step = serializer.compile(*found)) out->steps.push_back(std::move(step));
+                continue;
+            }
+            out->steps.push_back([load = serializer.load, value = *found](const std::vector<entt::entity>& ents) {
+                for(auto ent : ents) load(ent, value);
+            });
+        }
+        if(!deserializeFuncs.empty()) {
+            out->steps.push_back([data = out->data](const std::vector<entt::entity>& ents) {
+                for(auto ent : ents) {
+                    for(auto &func : deserializeFuncs) func(ent, data);
+                }
+            });
+        }
+        return out;
+    }
+
+    std::shared_ptr<const CompiledPrototype> getCompiledPrototype(const std::string& name) {
+        auto &cache = prototypeCache();
+        auto key = foldPrototypeName(name);
+        if(auto found = cache.find(key); found != cache.end()) return found->second;
+
+        std::shared_ptr<const CompiledPrototype> compiled;
+        {
+            auto q = prepare(*db, "SELECT name, data FROM prototypes WHERE name = ?;");
+            q->bind(1, name);
+            if(q->executeStep()) {
+                compiled = compilePrototype(q->getColumn(0).getString(), nlohmann::json::parse(q->getColumn(1).getText()));
+            }
+        }
+        cache[key] = compiled;
+        return compiled;
+    }
+
+    void invalidatePrototype(const std::string& name) {
+        prototypeCache().erase(foldPrototypeName(name));
+    }
+
+    void clearPrototypeCache() {
+        prototypeCache().clear();
+    }
+
+    void savePrototype(const std::string& name, const nlohmann::json& j) {
+        auto q = prepare(*db, "INSERT INTO prototypes (name, data) VALUES (?, ?) ON CONFLICT(name) DO UPDATE SET data = excluded.data;");
+        q->bind(1, name);
+        q->bind(2, j.dump(4, ' ', false, nlohmann::json::error_handler_t::ignore));
+        q->exec();
+        invalidatePrototype(name);
+    }
+
+    std::optional<nlohmann::json> getPrototype(const std::string& name) {
+        if(auto compiled = getCompiledPrototype(name)) return compiled->data;
+        return std::nullopt;
+    }
+
+    OpResult<std::vector<entt::entity>> spawnFromPrototype(const std::string& name, std::size_t count) {
+        auto compiled = getCompiledPrototype(name);
+        if(!compiled) return {{}, fmt::format("No such prototype: {}", name)};
+        if(!count) return {{}, std::nullopt};
+
+        auto ents = createObjects(count);
+        for(auto &step : compiled->steps) step(ents);
+        for(auto ent : ents) setDirty(ent, false);
+        return {std::move(ents), std::nullopt};
+    }
+
+}
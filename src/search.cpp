@@ -79,6 +79,13 @@ namespace core {
         return canDetect(ent, target, useModes);
     }
 
+    using GetHook = std::vector<entt::entity>(*)(entt::entity);
+
+    static bool isDefaultHook(const std::function<std::vector<entt::entity>(entt::entity)>& hook, GetHook def) {
+        auto fn = hook.target<GetHook>();
+        return fn && *fn == def;
+    }
+
     std::vector<entt::entity> Search::find(std::string_view name) {
         auto [res, handled] = _simplecheck(name);
         if(handled) {
@@ -127,13 +134,19 @@ namespace core {
         std::vector<entt::entity> results;
 
         for(const auto&[t, l] : searchLocations) {
-            std::vector<entt::entity> ents;
+            // Nothing below moves anything, so views will do. A game which replaced a get hook
+            // rather than its view hook is still searched through the get hook.
+            EntityView ents;
+            std::vector<entt::entity> copied;
             if(t == SearchContainer::Room) {
-                ents = getRoomContents(l);
+                if(isDefaultHook(getRoomContents, defaultGetRoomContents)) ents = viewRoomContents(l);
+                else ents = EntityView(copied = getRoomContents(l));
             } else if(t == SearchContainer::Inventory) {
-                ents = getInventory(l);
+                if(isDefaultHook(getInventory, defaultGetInventory)) ents = viewInventory(l);
+                else ents = EntityView(copied = getInventory(l));
             } else if(t == SearchContainer::Equipment) {
-                ents = getEquipment(l);
+                if(isDefaultHook(getEquipment, defaultGetEquipment)) ents = viewEquipment(l);
+                else ents = EntityView(copied = getEquipment(l));
             }
 
             if(ents.empty()) continue;
@@ -1,5 +1,6 @@
 #include "core/session.h"
 #include "core/connection.h"
+#include "core/accounts.h"
 
 namespace core {
 
@@ -138,11 +139,11 @@ namespace core {
     }
 
     void Session::start() {
-
+        recordCharacterLogin(id.index);
     }
 
     void Session::end() {
-
+        recordCharacterLogout(id.index, std::chrono::duration<double>(std::chrono::system_clock::now() - created).count());
     }
 
     std::shared_ptr<Session> defaultMakeSession(ObjectId id, int64_t, entt::entity character) {
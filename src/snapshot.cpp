@@ -0,0 +1,458 @@
+#include "core/snapshot.h"
+#include "core/database.h"
+#include "core/journal.h"
+#include "core/components.h"
+#include "core/api.h"
+#include "core/config.h"
+#include "core/containment.h"
+#include "core/link.h"
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace core {
+
+    static constexpr char snapshotMagic[8] = {'C', 'M', 'U', 'D', 'S', 'N', 'A', 'P'};
+
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        int64_t epoch;
+        uint64_t checksum;
+        uint64_t bodySize;
+    };
+
+    class SnapshotWriter {
+    public:
+        template<typename T>
+        void put(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            auto p = reinterpret_cast<const uint8_t*>(&value);
+            body.insert(body.end(), p, p + sizeof(T));
+        }
+        void putBytes(const void* data, std::size_t size) {
+            auto p = static_cast<const uint8_t*>(data);
+            body.insert(body.end(), p, p + size);
+        }
+        // Patches a count written earlier with put<uint64_t>(0).
+        void patch(std::size_t offset, uint64_t value) {
+            std::memcpy(body.data() + offset, &value, sizeof(value));
+        }
+        std::vector<uint8_t> body;
+    };
+
+    class SnapshotReader {
+    public:
+        SnapshotReader(const uint8_t* data, std::size_t size) : data(data), size(size) {}
+        template<typename T>
+        T get() {
+            static_assert(std::is_trivially_copyable_v<T>);
+            T out;
+            std::memcpy(&out, take(sizeof(T)), sizeof(T));
+            return out;
+        }
+        const uint8_t* take(std::size_t count) {
+            if(count > size - pos) throw std::runtime_error("snapshot is truncated");
+            auto out = data + pos;
+            pos += count;
+            return out;
+        }
+        [[nodiscard]] bool done() const { return pos == size; }
+    protected:
+        const uint8_t* data;
+        std::size_t size;
+        std::size_t pos{0};
+    };
+
+    // These are stored natively by the snapshot. Everything else an object has, including the
+    // output of serializeFuncs, is carried along as a MessagePack blob per object.
+    static const std::vector<std::string> textKeys = {"Name", "ShortDescription", "RoomDescription", "LookDescription"};
+    static const std::vector<std::string> relationKeys = {"Location", "Parent", "Owner"};
+    static const std::vector<std::string> tagKeys = {"Item", "Character", "NPC", "Vehicle"};
+    static const std::vector<std::string> otherNativeKeys = {"GridLocation", "RoomLocation", "Player"};
+
+    static bool isNativeKey(const std::string& key) {
+        for(auto list : {&textKeys, &relationKeys, &tagKeys, &otherNativeKeys}) {
+            if(std::find(list->begin(), list->end(), key) != list->end()) return true;
+        }
+        return false;
+    }
+
+    template<typename T>
+    static void writeText(SnapshotWriter& w, std::unordered_map<const char*, uint32_t>& stringIds) {
+        auto view = registry.view<ObjectId, T>();
+        auto countAt = w.body.size();
+        w.put<uint64_t>(0);
+        uint64_t count = 0;
+        for(auto ent : view) {
+            auto [id, text] = view.get(ent);
+            auto found = stringIds.find(text.data.data());
+            if(found == stringIds.end()) continue;
+            w.put<uint64_t>(id.index);
+            w.put<uint32_t>(found->second);
+            count++;
+        }
+        w.patch(countAt, count);
+    }
+
+    template<typename T>
+    static void writeRelation(SnapshotWriter& w) {
+        auto view = registry.view<ObjectId, T>();
+        auto countAt = w.body.size();
+        w.put<uint64_t>(0);
+        uint64_t count = 0;
+        for(auto ent : view) {
+            auto [id, rel] = view.get(ent);
+            auto target = registry.try_get<ObjectId>(rel.data);
+            if(!target) continue;
+            w.put<uint64_t>(id.index);
+            w.put<uint64_t>(target->index);
+            count++;
+        }
+        w.patch(countAt, count);
+    }
+
+    template<typename T>
+    static void writeTag(SnapshotWriter& w) {
+        auto view = registry.view<ObjectId, T>();
+        auto countAt = w.body.size();
+        w.put<uint64_t>(0);
+        uint64_t count = 0;
+        for(auto ent : view) {
+            w.put<uint64_t>(view.template get<ObjectId>(ent).index);
+            count++;
+        }
+        w.patch(countAt, count);
+    }
+
+    OpResult<> writeSnapshot(const std::string& path) {
+        // Cold objects aren't in the registry, so a snapshot taken now would lose them.
+        if(!coldObjects.empty()) return {false, fmt::format("{} objects are in cold zones", coldObjects.size())};
+        // The snapshot must describe exactly what the database holds at this epoch.
+        checkpointDatabase();
+        auto epoch = getSaveEpoch(*db);
+
+        SnapshotWriter w;
+
+        // Strings. Only those actually referenced by a text component are written.
+        std::unordered_map<const char*, uint32_t> stringIds;
+        std::vector<std::string_view> strings;
+        auto collect = [&]<typename T>() {
+            for(auto ent : registry.view<ObjectId, T>()) {
+                auto sv = registry.get<T>(ent).data;
+                if(stringIds.emplace(sv.data(), strings.size()).second) strings.push_back(sv);
+            }
+        };
+        collect.operator()<Name>();
+        collect.operator()<ShortDescription>();
+        collect.operator()<RoomDescription>();
+        collect.operator()<LookDescription>();
+        w.put<uint64_t>(strings.size());
+        for(auto sv : strings) {
+            w.put<uint32_t>(sv.size());
+            w.putBytes(sv.data(), sv.size());
+        }
+
+        // The objects arena.
+        auto objView = registry.view<ObjectId>();
+        w.put<uint64_t>(objView.size());
+        for(auto ent : objView) {
+            auto &id = objView.get<ObjectId>(ent);
+            w.put<uint64_t>(id.index);
+            w.put<int64_t>(id.generation);
+        }
+
+        writeText<Name>(w, stringIds);
+        writeText<ShortDescription>(w, stringIds);
+        writeText<RoomDescription>(w, stringIds);
+        writeText<LookDescription>(w, stringIds);
+
+        writeRelation<Location>(w);
+        writeRelation<Parent>(w);
+        writeRelation<Owner>(w);
+
+        writeTag<Item>(w);
+        writeTag<Character>(w);
+        writeTag<NPC>(w);
+        writeTag<Vehicle>(w);
+
+        {
+            auto view = registry.view<ObjectId, GridLocation>();
+            auto countAt = w.body.size();
+            w.put<uint64_t>(0);
+            uint64_t count = 0;
+            for(auto ent : view) {
+                auto [id, gloc] = view.get(ent);
+                w.put<uint64_t>(id.index);
+                w.put<int64_t>(gloc.data.x);
+                w.put<int64_t>(gloc.data.y);
+                w.put<int64_t>(gloc.data.z);
+                count++;
+            }
+            w.patch(countAt, count);
+        }
+
+        {
+            auto view = registry.view<ObjectId, RoomLocation>();
+            auto countAt = w.body.size();
+            w.put<uint64_t>(0);
+            uint64_t count = 0;
+            for(auto ent : view) {
+                auto [id, rloc] = view.get(ent);
+                w.put<uint64_t>(id.index);
+                w.put<uint64_t>(rloc.id);
+                count++;
+            }
+            w.patch(countAt, count);
+        }
+
+        {
+            auto view = registry.view<ObjectId, Player>();
+            auto countAt = w.body.size();
+            w.put<uint64_t>(0);
+            uint64_t count = 0;
+            for(auto ent : view) {
+                auto [id, player] = view.get(ent);
+                w.put<uint64_t>(id.index);
+                w.put<int64_t>(player.accountId);
+                count++;
+            }
+            w.patch(countAt, count);
+        }
+
+        // Everything else, per object.
+        {
+            auto countAt = w.body.size();
+            w.put<uint64_t>(0);
+            uint64_t count = 0;
+            std::vector<entt::entity> ents(objView.begin(), objView.end());
+            auto extras = serializeEntities(ents, false, true, [](const ComponentSerializer& s) {
+                return !isNativeKey(s.key);
+            });
+            for(std::size_t i = 0; i < ents.size(); i++) {
+                auto ent = ents[i];
+                auto &j = extras[i];
+                if(j.is_null() || j.empty()) continue;
+                auto encoded = nlohmann::json::to_msgpack(j);
+                w.put<uint64_t>(objView.get<ObjectId>(ent).index);
+                w.put<uint64_t>(encoded.size());
+                w.putBytes(encoded.data(), encoded.size());
+                count++;
+            }
+            w.patch(countAt, count);
+        }
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+        header.version = snapshotVersion;
+        header.epoch = epoch;
+        header.bodySize = w.body.size();
+        header.checksum = checksum64(w.body.data(), w.body.size());
+
+        auto tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if(!out) return {false, fmt::format("Could not open {} for writing", tmp)};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(w.body.data()), static_cast<std::streamsize>(w.body.size()));
+            out.flush();
+            if(!out) return {false, fmt::format("Could not write {}", tmp)};
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        if(ec) return {false, fmt::format("Could not rename {} to {}: {}", tmp, path, ec.message())};
+
+        logger->info("Wrote snapshot of {} objects at epoch {} ({} bytes).", objView.size(), epoch, w.body.size());
+        return {true, std::nullopt};
+    }
+
+    struct TextEntry { uint64_t obj; uint32_t str; };
+    struct RelationEntry { uint64_t obj; uint64_t target; };
+    struct GridEntry { uint64_t obj; int64_t x, y, z; };
+    struct ValueEntry { uint64_t obj; int64_t value; };
+    struct ExtraEntry { uint64_t obj; const uint8_t* data; std::size_t size; };
+
+    OpResult<> loadSnapshot(const std::string& path) {
+        namespace bip = boost::interprocess;
+        if(!std::filesystem::exists(path)) return {false, "no snapshot"};
+
+        std::unique_ptr<bip::file_mapping> file;
+        std::unique_ptr<bip::mapped_region> region;
+        try {
+            file = std::make_unique<bip::file_mapping>(path.c_str(), bip::read_only);
+            region = std::make_unique<bip::mapped_region>(*file, bip::read_only);
+        } catch(bip::interprocess_exception& e) {
+            return {false, fmt::format("could not map snapshot: {}", e.what())};
+        }
+
+        auto base = static_cast<const uint8_t*>(region->get_address());
+        auto size = region->get_size();
+        if(size < sizeof(SnapshotHeader)) return {false, "snapshot is truncated"};
+
+        SnapshotHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if(std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0) return {false, "not a snapshot"};
+        if(header.version != snapshotVersion) return {false, fmt::format("snapshot version {} is not {}", header.version, snapshotVersion)};
+        if(header.bodySize != size - sizeof(SnapshotHeader)) return {false, "snapshot is truncated"};
+        auto epoch = getSaveEpoch(*db);
+        if(header.epoch != epoch) return {false, fmt::format("snapshot epoch {} is behind database epoch {}", header.epoch, epoch)};
+
+        auto body = base + sizeof(SnapshotHeader);
+        if(checksum64(body, header.bodySize) != header.checksum) return {false, "snapshot checksum mismatch"};
+
+        // Decode everything before touching the registry, so that a bad file can't leave
+        // the world half-loaded.
+        std::vector<std::string_view> strings;
+        std::vector<std::pair<uint64_t, int64_t>> objs;
+        std::vector<std::vector<TextEntry>> texts(textKeys.size());
+        std::vector<std::vector<RelationEntry>> relations(relationKeys.size());
+        std::vector<std::vector<uint64_t>> tags(tagKeys.size());
+        std::vector<GridEntry> grids;
+        std::vector<ValueEntry> roomLocations, players;
+        std::vector<ExtraEntry> extras;
+        uint64_t maxIndex = 0;
+
+        try {
+            SnapshotReader r(body, header.bodySize);
+            auto count = r.get<uint64_t>();
+            for(uint64_t i = 0; i < count; i++) {
+                auto len = r.get<uint32_t>();
+                strings.emplace_back(reinterpret_cast<const char*>(r.take(len)), len);
+            }
+            count = r.get<uint64_t>();
+            for(uint64_t i = 0; i < count; i++) {
+                auto index = r.get<uint64_t>();
+                auto gen = r.get<int64_t>();
+                objs.emplace_back(index, gen);
+                maxIndex = std::max(maxIndex, index);
+            }
+            for(auto &list : texts) {
+                count = r.get<uint64_t>();
+                for(uint64_t i = 0; i < count; i++) {
+                    auto obj = r.get<uint64_t>();
+                    auto str = r.get<uint32_t>();
+                    if(str >= strings.size()) throw std::runtime_error("bad string index");
+                    list.push_back({obj, str});
+                }
+            }
+            for(auto &list : relations) {
+                count = r.get<uint64_t>();
+                for(uint64_t i = 0; i < count; i++) {
+                    auto obj = r.get<uint64_t>();
+                    list.push_back({obj, r.get<uint64_t>()});
+                }
+            }
+            for(auto &list : tags) {
+                count = r.get<uint64_t>();
+                for(uint64_t i = 0; i < count; i++) list.push_back(r.get<uint64_t>());
+            }
+            count = r.get<uint64_t>();
+            for(uint64_t i = 0; i < count; i++) {
+                GridEntry e{};
+                e.obj = r.get<uint64_t>();
+                e.x = r.get<int64_t>();
+                e.y = r.get<int64_t>();
+                e.z = r.get<int64_t>();
+                grids.push_back(e);
+            }
+            for(auto list : {&roomLocations, &players}) {
+                count = r.get<uint64_t>();
+                for(uint64_t i = 0; i < count; i++) {
+                    auto obj = r.get<uint64_t>();
+                    list->push_back({obj, r.get<int64_t>()});
+                }
+            }
+            count = r.get<uint64_t>();
+            for(uint64_t i = 0; i < count; i++) {
+                auto obj = r.get<uint64_t>();
+                auto len = r.get<uint64_t>();
+                extras.push_back({obj, r.take(len), len});
+            }
+            if(!r.done()) throw std::runtime_error("trailing data");
+        } catch(std::exception& e) {
+            return {false, fmt::format("snapshot is malformed: {}", e.what())};
+        }
+
+        // Parse the leftover components up front too, on the worker pool.
+        std::vector<nlohmann::json> extraJson(extras.size());
+        try {
+            parallelFor(extras.size(), [&](std::size_t begin, std::size_t end) {
+                for(auto i = begin; i < end; i++) {
+                    extraJson[i] = nlohmann::json::from_msgpack(extras[i].data, extras[i].data + extras[i].size);
+                }
+            }, config::dbLoadThreads);
+        } catch(std::exception& e) {
+            return {false, fmt::format("snapshot is malformed: {}", e.what())};
+        }
+
+        // Everything checks out. From here on, the snapshot is what we're loading.
+        objects.resize(maxIndex + 50, {0, entt::null});
+        for(auto &[index, gen] : objs) {
+            auto ent = registry.create();
+            registry.emplace<ObjectId>(ent, index, gen);
+            objects[index] = {gen, ent};
+        }
+        auto resolve = [](uint64_t index) {
+            return index < objects.size() ? objects[index].second : entt::null;
+        };
+
+        auto applyText = [&]<typename T>(const std::vector<TextEntry>& list) {
+            for(auto &e : list) {
+                auto ent = resolve(e.obj);
+                if(registry.valid(ent)) registry.emplace_or_replace<T>(ent, std::string(strings[e.str]));
+            }
+        };
+        applyText.operator()<Name>(texts[0]);
+        applyText.operator()<ShortDescription>(texts[1]);
+        applyText.operator()<RoomDescription>(texts[2]);
+        applyText.operator()<LookDescription>(texts[3]);
+
+        // Everything is labelled at once at the end, rather than one setLocation() at a time.
+        FlagGuard deferGuard(deferContainment, true);
+        std::vector<OpResult<>(*)(entt::entity, entt::entity)> setters = {setLocation, setParent, setOwner};
+        for(std::size_t i = 0; i < relations.size(); i++) {
+            for(auto &e : relations[i]) {
+                auto ent = resolve(e.obj);
+                auto target = resolve(e.target);
+                if(registry.valid(ent) && registry.valid(target)) setters[i](ent, target);
+            }
+        }
+
+        auto applyTag = [&]<typename T>(const std::vector<uint64_t>& list) {
+            for(auto obj : list) {
+                auto ent = resolve(obj);
+                if(registry.valid(ent)) registry.get_or_emplace<T>(ent);
+            }
+        };
+        applyTag.operator()<Item>(tags[0]);
+        applyTag.operator()<Character>(tags[1]);
+        applyTag.operator()<NPC>(tags[2]);
+        applyTag.operator()<Vehicle>(tags[3]);
+
+        for(auto &e : grids) {
+            auto ent = resolve(e.obj);
+            if(registry.valid(ent)) registry.emplace_or_replace<GridLocation>(ent, GridPoint(e.x, e.y, e.z));
+        }
+        for(auto &e : roomLocations) {
+            auto ent = resolve(e.obj);
+            if(registry.valid(ent)) registry.get_or_emplace<RoomLocation>(ent).id = e.value;
+        }
+        for(auto &e : players) {
+            auto ent = resolve(e.obj);
+            if(registry.valid(ent)) registry.get_or_emplace<Player>(ent).accountId = e.value;
+        }
+
+        for(std::size_t i = 0; i < extras.size(); i++) {
+            auto ent = resolve(extras[i].obj);
+            if(registry.valid(ent)) deserializeEntity(ent, extraJson[i]);
+        }
+
+        rebuildContainment();
+        broadcast(fmt::format("Loaded {} objects from snapshot at epoch {}.", objs.size(), epoch));
+        return {true, std::nullopt};
+    }
+
+}
@@ -1,6 +1,12 @@
 #include "core/system.h"
 #include "core/connection.h"
 #include "core/session.h"
+#include "core/database.h"
+#include "core/zone.h"
+#include "core/accounts.h"
+#include "core/backup.h"
+#include "core/config.h"
+#include "core/api.h"
 
 namespace core {
 
@@ -73,9 +79,139 @@ namespace core {
         co_return;
     }
 
+    async<void> ProcessDeletions::run(double deltaTime) {
+        auto count = processDeletions();
+        if(count) logger->debug("Deleted {} objects.", count);
+        co_return;
+    }
+
+    async<void> ProcessDatabase::run(double deltaTime) {
+        processSaveResults();
+        sinceAccountFlush += deltaTime;
+        if(sinceAccountFlush >= std::chrono::duration<double>(config::accountFlushInterval).count()) {
+            sinceAccountFlush = 0.0;
+            flushAccountUpdates();
+        }
+        co_return;
+    }
+
+    CheckpointMetrics checkpointMetrics;
+
+    async<bool> ProcessCheckpoint::shouldRun(double deltaTime) {
+        co_return config::checkpointIncremental;
+    }
+
+    std::size_t ProcessCheckpoint::epochRemaining() const {
+        return (epochObjects.size() - objectCursor) + (epochSubEntities.size() - subEntityCursor);
+    }
+
+    void ProcessCheckpoint::startEpoch() {
+        if(checkpointMetrics.epoch > 0) checkpointMetrics.lastEpochTicks = checkpointMetrics.epochTicks;
+        epochObjects.clear();
+        epochSubEntities.clear();
+        objectCursor = 0;
+        subEntityCursor = 0;
+        // An object can be in both dirty and dirtyComponents; snapshotDirtyObject() handles both at
+        // once, and skips it the second time.
+        epochObjects.reserve(dirty.size() + dirtyComponents.size());
+        epochObjects.insert(epochObjects.end(), dirty.begin(), dirty.end());
+        epochObjects.insert(epochObjects.end(), dirtyComponents.begin(), dirtyComponents.end());
+        epochSubEntities.assign(dirtySubEntities.begin(), dirtySubEntities.end());
+        checkpointMetrics.epoch++;
+        checkpointMetrics.epochTicks = 0;
+    }
+
+    async<void> ProcessCheckpoint::run(double deltaTime) {
+        auto started = std::chrono::steady_clock::now();
+        if(epochRemaining() == 0) {
+            if(dirty.empty() && dirtyComponents.empty() && dirtySubEntities.empty()) {
+                checkpointMetrics.savedLastTick = 0;
+                checkpointMetrics.bytesLastTick = 0;
+                checkpointMetrics.backlog = 0;
+                checkpointMetrics.drainRate *= 0.9;
+                co_return;
+            }
+            startEpoch();
+        }
+        checkpointMetrics.epochTicks++;
+
+        // How much must be done this tick no matter the budget, to finish the epoch on time.
+        std::size_t required = 0;
+        if(config::checkpointEpochTicks > 0) {
+            auto ticksLeft = config::checkpointEpochTicks > checkpointMetrics.epochTicks
+                    ? config::checkpointEpochTicks - checkpointMetrics.epochTicks + 1 : 1;
+            required = (epochRemaining() + ticksLeft - 1) / ticksLeft;
+        }
+
+        std::vector<ObjectSnapshot> batch;
+        std::size_t saved = 0, bytes = 0;
+        auto overBudget = [&]() {
+            if(saved < required) return false;
+            if(config::checkpointByteBudget > 0 && bytes >= config::checkpointByteBudget) return true;
+            return std::chrono::steady_clock::now() - started >= config::checkpointTimeBudget;
+        };
+
+        while(epochRemaining() > 0 && !overBudget()) {
+            std::size_t size;
+            if(objectCursor < epochObjects.size()) {
+                size = snapshotDirtyObject(epochObjects[objectCursor++], batch);
+            } else {
+                size = snapshotDirtySubEntity(epochSubEntities[subEntityCursor++], batch);
+            }
+            // Entries already saved by someone else don't count against the budget.
+            if(size) {
+                saved++;
+                bytes += size;
+            }
+        }
+        if(!batch.empty()) submitSnapshots(std::move(batch));
+
+        checkpointMetrics.savedLastTick = saved;
+        checkpointMetrics.bytesLastTick = bytes;
+        checkpointMetrics.epochRemaining = epochRemaining();
+        checkpointMetrics.backlog = dirty.size() + dirtyComponents.size() + dirtySubEntities.size();
+        if(deltaTime > 0.0) {
+            checkpointMetrics.drainRate = checkpointMetrics.drainRate * 0.9 + (saved / deltaTime) * 0.1;
+        }
+        co_return;
+    }
+
+    async<bool> ProcessZones::shouldRun(double deltaTime) {
+        if(config::zoneIdleTimeout.count() <= 0) co_return false;
+        elapsed += deltaTime;
+        if(elapsed < std::chrono::duration<double>(config::zoneCheckInterval).count()) co_return false;
+        elapsed = 0.0;
+        co_return true;
+    }
+
+    async<void> ProcessZones::run(double deltaTime) {
+        updateZoneActivity();
+        evictIdleZones();
+        co_return;
+    }
+
+    async<bool> ProcessBackups::shouldRun(double deltaTime) {
+        if(config::dbBackupInterval.count() <= 0) co_return false;
+        elapsed += deltaTime;
+        if(elapsed < std::chrono::duration<double>(config::dbBackupInterval).count()) co_return false;
+        elapsed = 0.0;
+        co_return true;
+    }
+
+    async<void> ProcessBackups::run(double deltaTime) {
+        auto [res, err] = startBackup(makeBackupPath());
+        if(!res) logger->warn("Not starting a scheduled backup: {}", err.value_or("unknown reason"));
+        co_return;
+    }
+
     void registerSystems() {
         registerSystem(std::make_shared<ProcessConnections>());
         registerSystem(std::make_shared<ProcessSessions>());
+        registerSystem(std::make_shared<ProcessDeletions>());
+        registerSystem(std::make_shared<ProcessDatabase>());
+        registerSystem(std::make_shared<ProcessCheckpoint>());
+        registerSystem(std::make_shared<ProcessZones>());
+        registerSystem(std::make_shared<ProcessBackups>());
         //registerSystem(std::make_shared<ProcessOutput>());
         //registerSystem(std::make_shared<ProcessCommands>());
     }
@@ -0,0 +1,192 @@
+#include "core/zone.h"
+#include "core/api.h"
+#include "core/config.h"
+#include "core/journal.h"
+
+namespace core {
+
+    std::unordered_map<std::size_t, std::vector<std::size_t>> coldZoneContents;
+
+    bool isZone(entt::entity ent) {
+        return registry.valid(ent) && registry.any_of<Area, Expanse, Map, Space>(ent);
+    }
+
+    bool isZoneCold(entt::entity zone) {
+        return registry.valid(zone) && registry.all_of<ColdZone>(zone);
+    }
+
+    entt::entity getZone(entt::entity ent) {
+        auto loc = getLocation(ent);
+        while(registry.valid(loc)) {
+            if(isZone(loc)) return loc;
+            loc = getLocation(loc);
+        }
+        return entt::null;
+    }
+
+    void setObjectCold(std::size_t index, int64_t generation, const ObjectId& zone) {
+        if(index >= objects.size()) objects.resize(index + 40, {0, entt::null});
+        objects[index] = {generation, entt::null};
+        coldObjects[index] = zone;
+        coldZoneContents[zone.index].push_back(index);
+    }
+
+    bool defaultWarmObject(std::size_t index) {
+        auto found = coldObjects.find(index);
+        if(found == coldObjects.end()) return false;
+        auto zone = found->second.getObject();
+        if(!isZoneCold(zone)) return false;
+        hydrateZone(zone);
+        return !isObjectCold(index);
+    }
+    std::function<bool(std::size_t)> warmObject = defaultWarmObject;
+
+    void defaultHydrateZone(entt::entity zone) {
+        if(!isZoneCold(zone)) return;
+        auto started = std::chrono::steady_clock::now();
+        auto &activity = registry.get_or_emplace<ZoneActivity>(zone);
+        activity.lastActive = started;
+        bool evicted = activity.evicted;
+        // Cleared first, so that anything inside which refers back here doesn't try again.
+        registry.remove<ColdZone>(zone);
+        // Whatever was saved when it was evicted might still be waiting on the writer.
+        if(evicted) awaitWriter();
+
+        auto count = loadZoneContents(zone);
+        logger->info("Hydrated zone {} with {} objects in {:.3f} seconds.", registry.get<ObjectId>(zone).toString(),
+                     count, std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+    }
+    std::function<void(entt::entity)> hydrateZone = defaultHydrateZone;
+
+    void ensureHydrated(entt::entity ent) {
+        if(isZoneCold(ent)) hydrateZone(ent);
+    }
+
+    void collectSubEntities(entt::entity zone, std::vector<entt::entity>& out) {
+        if(auto area = registry.try_get<Area>(zone)) {
+            for(auto &[id, room] : area->data) out.push_back(room);
+            area->data.clear();
+        }
+        if(auto grid = registry.try_get<Expanse>(zone)) {
+            for(auto &[point, poi] : grid->poi) out.push_back(poi);
+            grid->poi.clear();
+        }
+        if(auto grid = registry.try_get<Map>(zone)) {
+            for(auto &[point, poi] : grid->poi) out.push_back(poi);
+            grid->poi.clear();
+        }
+        if(auto grid = registry.try_get<Space>(zone)) {
+            for(auto &[point, poi] : grid->poi) out.push_back(poi);
+            grid->poi.clear();
+        }
+    }
+
+    OpResult<> defaultEvictZone(entt::entity zone) {
+        if(!isZone(zone)) return {false, "That is not a zone."};
+        if(isZoneCold(zone)) return {true, std::nullopt};
+        auto zoneId = registry.get<ObjectId>(zone);
+
+        // Everything located in the zone, however deeply. Zones inside of it stay loaded.
+        std::vector<entt::entity> members;
+        std::unordered_set<entt::entity> inside;
+        auto stack = getContents(zone);
+        while(!stack.empty()) {
+            auto ent = stack.back();
+            stack.pop_back();
+            if(!registry.valid(ent) || isZone(ent) || !inside.insert(ent).second) continue;
+            members.push_back(ent);
+            for(auto c : viewContents(ent)) stack.push_back(c);
+        }
+
+        for(auto ent : members) {
+            if(registry.all_of<SessionHolder>(ent)) return {false, "Someone is playing in it."};
+            if(!registry.all_of<ObjectId>(ent)) return {false, "It contains something which can't be saved."};
+            // Whatever is Parented or Owned by an evicted object would be left pointing at nothing.
+            for(auto child : viewChildren(ent)) {
+                if(!inside.contains(child)) return {false, "Something outside of it has a Parent inside."};
+            }
+            for(auto child : viewAssets(ent)) {
+                if(!inside.contains(child)) return {false, "Something outside of it has an Owner inside."};
+            }
+            // Nor could an outside Parent or Owner get its link back when the zone is hydrated;
+            // nothing outside is reloaded.
+            if(auto par = registry.try_get<Parent>(ent); par && !inside.contains(par->data)) {
+                return {false, "Something inside of it has a Parent outside."};
+            }
+            if(auto par = registry.try_get<Owner>(ent); par && !inside.contains(par->data)) {
+                return {false, "Something inside of it has an Owner outside."};
+            }
+        }
+
+        // Every pending change inside must be on its way to the database before it's released.
+        processDirty();
+
+        // None of what follows is a change that needs saving.
+        FlagGuard guard(gameIsLoading, true);
+        for(auto ent : members) {
+            if(auto par = registry.try_get<Location>(ent); par && !inside.contains(par->data)) {
+                removeFromContents(par->data, ent);
+            }
+        }
+        for(auto ent : members) {
+            auto id = registry.get<ObjectId>(ent);
+            setObjectCold(id.index, id.generation, zoneId);
+            registry.destroy(ent);
+        }
+        std::vector<entt::entity> subs;
+        collectSubEntities(zone, subs);
+        for(auto sub : subs) {
+            if(registry.valid(sub)) registry.destroy(sub);
+        }
+
+        registry.emplace_or_replace<ColdZone>(zone);
+        registry.get_or_emplace<ZoneActivity>(zone).evicted = true;
+        logger->info("Evicted zone {} with {} objects.", zoneId.toString(), members.size());
+        return {true, std::nullopt};
+    }
+    std::function<OpResult<>(entt::entity)> evictZone = defaultEvictZone;
+
+    template<typename T>
+    static void trackZones(std::vector<entt::entity>& untracked) {
+        for(auto ent : registry.view<T>(entt::exclude<ZoneActivity, ColdZone>)) untracked.push_back(ent);
+    }
+
+    void updateZoneActivity() {
+        // Zones loaded at startup have no ZoneActivity yet.
+        std::vector<entt::entity> untracked;
+        trackZones<Area>(untracked);
+        trackZones<Expanse>(untracked);
+        trackZones<Map>(untracked);
+        trackZones<Space>(untracked);
+        for(auto ent : untracked) registry.emplace_or_replace<ZoneActivity>(ent);
+
+        auto now = std::chrono::steady_clock::now();
+        for(auto ent : registry.view<SessionHolder>()) {
+            auto zone = getZone(ent);
+            if(registry.valid(zone)) registry.get_or_emplace<ZoneActivity>(zone).lastActive = now;
+        }
+    }
+
+    std::size_t evictIdleZones() {
+        if(config::zoneIdleTimeout.count() <= 0) return 0;
+        auto now = std::chrono::steady_clock::now();
+        std::vector<entt::entity> idle;
+        for(auto &&[ent, activity] : registry.view<ZoneActivity>(entt::exclude<ColdZone>).each()) {
+            if(now - activity.lastActive >= config::zoneIdleTimeout) idle.push_back(ent);
+        }
+
+        std::size_t evicted = 0;
+        for(auto ent : idle) {
+            auto [res, err] = evictZone(ent);
+            if(res) {
+                evicted++;
+                continue;
+            }
+            // Don't try again until it's been idle for another full timeout.
+            registry.get<ZoneActivity>(ent).lastActive = now;
+            logger->debug("Not evicting zone {}: {}", registry.get<ObjectId>(ent).toString(), err.value_or("unknown reason"));
+        }
+        return evicted;
+    }
+
+}